@@ -7,6 +7,8 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <ctype.h>
 
 #include <libyottadb.h>
 #include <lua.h>
@@ -225,6 +227,206 @@ int cachearray_create(lua_State *L) {
   return 1;
 }
 
+// Return true if YDB is running in UTF-8 mode, in which $C(n) specifies a Unicode code point rather than a byte
+static bool utf8_mode(void) {
+  static int mode = -1;
+  if (mode < 0) {
+    const char *chset = getenv("ydb_chset");
+    if (!chset) chset = getenv("gtm_chset");
+    const char *utf8 = "UTF-8";
+    mode = chset != NULL;
+    for (int i=0; mode && i<=5; i++)
+      mode = toupper((unsigned char)chset[i]) == utf8[i];
+  }
+  return mode;
+}
+
+// Parse the string from `p` to `end` into `number` if it is an M canonical number that YDB collates as a number
+// (e.g. `-12.5` or `.5` but not `012` or `1.50`). Canonical numbers with more digits than YDB can store are strings to YDB.
+// This is the single definition of a numeric subscript used by cachearrays, typed subscripts and merge_iter().
+// @return true if the string is a number
+bool parse_canonical_number(const char *p, const char *end, m_number_t *number) {
+  number->negative = false;
+  number->integer = number->fraction = p;
+  number->integer_len = number->fraction_len = 0;
+  if (end-p == 1 && *p == '0') return true;  // zero is only canonical on its own: not "-0", "01" or "0.5"
+  if (p < end && *p == '-') number->negative = true, p++;
+  if (p == end || *p == '0') return false;
+  number->integer = p;
+  while (p < end && *p >= '0' && *p <= '9') p++;
+  number->integer_len = p - number->integer;
+  int significant = number->integer_len;
+  if (p < end) {
+    if (*p++ != '.' || p == end || end[-1] == '0') return false;  // fraction needs digits but no trailing zero
+    number->fraction = p;
+    while (p < end && *p >= '0' && *p <= '9') p++;
+    if (p != end) return false;
+    number->fraction_len = p - number->fraction;
+    significant += number->fraction_len;
+    if (!number->integer_len)
+      for (const char *q=number->fraction; *q == '0'; q++) significant--;  // leading zeros of a fraction are not significant
+  } else {
+    if (!number->integer_len) return false;
+    for (const char *q=end-1; *q == '0'; q--) significant--;  // nor are trailing zeros of an integer
+  }
+  return significant <= M_NUMBER_DIGITS && number->integer_len <= M_NUMBER_INTEGER_DIGITS;
+}
+
+// Case-insensitively match M function name `name` at `p`, immediately followed by '('
+// @return pointer past the '(' or NULL if no match
+static const char *match_function(const char *p, const char *end, const char *name) {
+  while (*name && p < end && toupper((unsigned char)*p) == *name) p++, name++;
+  return *name || p >= end || *p != '('? NULL: p+1;
+}
+
+// Parse a $C[HAR](n,...) or $ZCH[AR](n,...) list of characters starting at `p` (just past the '(') and store them at `out`.
+// @return pointer past the closing ')', or pointer to the error with *errmsg set
+static const char *parse_char_list(const char *p, const char *end, char **out, bool zchar, const char **errmsg) {
+  do {
+    long n = 0;
+    const char *digits = p;
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
+      if (n <= 0x10ffff) n = n*10 + (*p - '0');
+    if (p == digits) return *errmsg = "character code expected", p;
+    if (zchar || !utf8_mode()) {
+      if (n > 255) return *errmsg = "byte value must be 0-255", digits;
+      *(*out)++ = n;
+    } else if (n < 0x80) {
+      *(*out)++ = n;
+    } else if (n < 0x800) {
+      *(*out)++ = 0xc0 | (n>>6);
+      *(*out)++ = 0x80 | (n&0x3f);
+    } else if (n < 0x10000) {
+      *(*out)++ = 0xe0 | (n>>12);
+      *(*out)++ = 0x80 | ((n>>6)&0x3f);
+      *(*out)++ = 0x80 | (n&0x3f);
+    } else if (n <= 0x10ffff) {
+      *(*out)++ = 0xf0 | (n>>18);
+      *(*out)++ = 0x80 | ((n>>12)&0x3f);
+      *(*out)++ = 0x80 | ((n>>6)&0x3f);
+      *(*out)++ = 0x80 | (n&0x3f);
+    } else
+      return *errmsg = "character code must be a valid Unicode code point", digits;
+  } while (p < end && *p == ',' && p++);
+  if (p >= end || *p != ')') return *errmsg = "')' expected", p;
+  return p+1;
+}
+
+// Parse one subscript starting at `p`: a canonical number, or a concatenation with `_` of quoted strings
+// (with embedded quotes doubled) and $C()/$ZCH() character lists, as output by ZWRITE. Store it at `out`.
+// Output is never longer than the input it was parsed from.
+// @return pointer past the subscript, or pointer to the error with *errmsg set
+static const char *parse_subscript(const char *p, const char *end, char **out, const char **errmsg) {
+  if (p < end && (*p == '-' || *p == '.' || (*p >= '0' && *p <= '9'))) {
+    const char *number = p;
+    while (p < end && *p != ',' && *p != ')') p++;
+    m_number_t parsed;
+    if (!parse_canonical_number(number, p, &parsed)) return *errmsg = "canonical number expected", number;
+    memcpy(*out, number, p-number);
+    *out += p-number;
+    return p;
+  }
+  do {
+    const char *args;
+    if (p < end && *p == '"') {
+      const char *quote = p;
+      for (p++; p < end; p++) {
+        if (*p == '"') {
+          if (p+1 >= end || p[1] != '"') break;
+          p++;  // doubled quote is an embedded quote
+        }
+        *(*out)++ = *p;
+      }
+      if (p >= end) return *errmsg = "closing quote expected", quote;
+      p++;
+    } else if (p < end && *p == '$' && ((args = match_function(p+1, end, "C")) || (args = match_function(p+1, end, "CHAR")))) {
+      p = parse_char_list(args, end, out, false, errmsg);
+      if (*errmsg) return p;
+    } else if (p < end && *p == '$' && ((args = match_function(p+1, end, "ZCH")) || (args = match_function(p+1, end, "ZCHAR")))) {
+      p = parse_char_list(args, end, out, true, errmsg);
+      if (*errmsg) return p;
+    } else
+      return *errmsg = "quoted string, $C() or number expected", p;
+  } while (p < end && *p == '_' && p++);
+  return p;
+}
+
+/// Create a cachearray by parsing an M glvn string, e.g. `^X("a",1,"b"_$C(0))`, as produced by ZWRITE.
+// Subscripts may be canonical numbers, or quoted strings (with embedded quotes doubled) concatenated using `_`
+// with `$C()` or `$ZCH()` character lists. In UTF-8 mode (env `ydb_chset=UTF-8`), `$C(n)` specifies a Unicode
+// code point; otherwise it specifies a byte like `$ZCH(n)`.
+// The string is parsed directly into the cachearray without creating intermediate Lua strings.
+// Raise an error if the string is not a valid glvn.
+// @function cachearray_fromglvn
+// @usage _yottadb.cachearray_fromglvn(glvn)
+// @param glvn string
+// @return cachearray
+int cachearray_fromglvn(lua_State *L) {
+  size_t len;
+  const char *glvn = luaL_checklstring(L, 1, &len);
+  const char *p = glvn, *end = glvn+len;
+  const char *errmsg = NULL;
+
+  // Allocate generously since output subscripts can be no longer than the glvn string
+  int depth_alloc = 1;
+  for (const char *comma = p; (comma = memchr(comma, ',', end-comma)); comma++)
+    depth_alloc++;
+  if (depth_alloc > YDB_MAX_SUBS) depth_alloc = YDB_MAX_SUBS;
+  depth_alloc += ARRAY_OVERALLOC;
+  int subsdata_alloc = len + ARRAY_OVERALLOC*YDB_TYPICAL_SUBLEN;
+  cachearray_t *array = cachearray_new(L, sizeof(cachearray_t) + depth_alloc*sizeof(ydb_buffer_t) + subsdata_alloc, NO_PARENT);
+  array->dereference = array;
+  array->subsdata_alloc = subsdata_alloc;
+  array->depth_alloc = depth_alloc;
+  char *subsdata = get_subsdata(array);
+  char *out = subsdata;
+
+  // Parse varname
+  if (p < end && *p == '^') p++;
+  if (p < end && (*p == '%' || isalpha((unsigned char)*p)))
+    for (p++; p < end && isalnum((unsigned char)*p); p++);
+  else {
+    errmsg = "variable name expected";
+    goto error;
+  }
+  memcpy(out, glvn, p-glvn);
+  out += p-glvn;
+  array->varname.buf_addr = subsdata;
+  array->varname.len_used = array->varname.len_alloc = p-glvn;
+
+  // Parse subscripts
+  int depth = 0;
+  if (p < end && *p == '(') {
+    do {
+      p++;  // skip '(' or ','
+      if (depth >= YDB_MAX_SUBS) {
+        errmsg = "maximum number of subscripts exceeded";
+        goto error;
+      }
+      char *subscript = out;
+      p = parse_subscript(p, end, &out, &errmsg);
+      if (errmsg) goto error;
+      ydb_buffer_t *element = &array->subs[depth++];
+      element->buf_addr = subscript;
+      element->len_used = element->len_alloc = out-subscript;
+    } while (p < end && *p == ',');
+    if (p >= end || *p != ')') {
+      errmsg = "',' or ')' expected";
+      goto error;
+    }
+    p++;
+  }
+  if (p != end) {
+    errmsg = "end of glvn expected";
+    goto error;
+  }
+  array->depth = array->depth_used = depth;
+  return 1;
+
+error:
+  return luaL_error(L, "Cannot parse glvn: %s at character %d of: %s", errmsg, (int)(p-glvn)+1, glvn);
+}
+
 #if LUA_VERSION_NUM > 501
   #define my_setuservalue(L, index) lua_setuservalue((L), (index))
   #define my_getuservalue(L, index) lua_getuservalue((L), (index))
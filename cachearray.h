@@ -4,6 +4,7 @@
 #ifndef CACHEARRAY_H
 #define CACHEARRAY_H
 
+#include <stdbool.h>
 #include <libyottadb.h>
 
 // Maximum number of characters we allow in a ^varname+subscripts string
@@ -53,8 +54,21 @@ typedef struct cachearray_t_maxsize {
   char _subsdata[YDB_LARGE_SUBSLEN];
 } cachearray_t_maxsize;
 
+// Parts of an M canonical number, as parsed by parse_canonical_number()
+typedef struct {
+  bool negative;
+  const char *integer, *fraction;  // digits before and after the decimal point
+  int integer_len, fraction_len;  // zero has no digits at all
+} m_number_t;
+
+// Maximum significant digits and integer digits YDB stores in a numeric subscript
+#define M_NUMBER_DIGITS 18
+#define M_NUMBER_INTEGER_DIGITS 47
+
+bool parse_canonical_number(const char *p, const char *end, m_number_t *number);
 cachearray_t *_cachearray_create(lua_State *L, cachearray_t_maxsize *array_prealloc);
 int cachearray_create(lua_State *L);
+int cachearray_fromglvn(lua_State *L);
 int cachearray_setmetatable(lua_State *L);
 int cachearray_tomutable(lua_State *L);
 int cachearray_subst(lua_State *L);
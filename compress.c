@@ -0,0 +1,179 @@
+/// Compress node values using a small, fast LZ77 codec.
+// Copyright 2022-2023 Berwyn Hoyt. See LICENSE.
+// @module yottadb.c
+
+/// Compression functions
+// @section
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libyottadb.h>
+#include <lua.h>
+#include <lauxlib.h>
+
+#include "yottadb.h"
+#include "compress.h"
+
+// The compressed format is: COMPRESSED_MARKER, COMPRESSED_LZ, varint(uncompressed_length), then a sequence of
+//   varint(literal_count), literal bytes, varint(match_code)[, varint(match_offset)]
+// ending with a match_code of 0. A non-zero match_code copies `match_code+LZ_MIN_MATCH-1` bytes
+// from `match_offset` bytes back in the output (which may overlap the bytes being written).
+// Varints are little-endian base-128 with the top bit of each byte flagging that more bytes follow.
+
+static inline size_t put_varint(unsigned char *out, size_t n) {
+  size_t len = 0;
+  while (n >= 0x80) {
+    out[len++] = (unsigned char)(n | 0x80);
+    n >>= 7;
+  }
+  out[len++] = (unsigned char)n;
+  return len;
+}
+
+// Decode a varint at `p` into `*n`
+// @return pointer to the byte after the varint, or NULL if it overruns `end` or the maximum value string length
+static inline const unsigned char *get_varint(const unsigned char *p, const unsigned char *end, size_t *n) {
+  size_t value = 0;
+  for (int shift = 0; p < end && shift <= 28; shift += 7) {
+    unsigned char byte = *p++;
+    value |= (size_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      *n = value;
+      return value <= YDB_MAX_STR? p: NULL;
+    }
+  }
+  return NULL;
+}
+
+static inline uint32_t read32(const unsigned char *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// Compress `len` bytes at `in` into `out`, which must have space for 2*len+32 bytes (the worst case).
+// Matches are found greedily using a hash table of the most recent position of each 4-byte sequence.
+// @return length of compressed output, excluding the header
+static size_t lz_encode(const unsigned char *in, size_t len, unsigned char *out) {
+  uint32_t table[1<<LZ_HASH_BITS];  // position+1 of the last occurrence of each hash, or 0
+  memset(table, 0, sizeof(table));
+  size_t ip = 0, anchor = 0, op = 0;
+  while (ip + LZ_MIN_MATCH <= len) {
+    uint32_t sequence = read32(in+ip);
+    uint32_t h = (sequence * 2654435761u) >> (32-LZ_HASH_BITS);
+    size_t candidate = table[h];
+    table[h] = (uint32_t)ip + 1;
+    if (!candidate || read32(in+candidate-1) != sequence) {
+      ip++;
+      continue;
+    }
+    size_t ref = candidate-1, match_len = LZ_MIN_MATCH;
+    while (ip+match_len < len && in[ref+match_len] == in[ip+match_len])
+      match_len++;
+    op += put_varint(out+op, ip-anchor);
+    memcpy(out+op, in+anchor, ip-anchor);
+    op += ip-anchor;
+    op += put_varint(out+op, match_len-LZ_MIN_MATCH+1);
+    op += put_varint(out+op, ip-ref);
+    ip += match_len;
+    anchor = ip;
+  }
+  op += put_varint(out+op, len-anchor);
+  memcpy(out+op, in+anchor, len-anchor);
+  op += len-anchor;
+  op += put_varint(out+op, 0);
+  return op;
+}
+
+// Decompress `in` to `end` into exactly `len` bytes at `out`
+// @return true on success; false if the compressed data is corrupt
+static bool lz_decode(const unsigned char *in, const unsigned char *end, unsigned char *out, size_t len) {
+  size_t op = 0, count, code, offset;
+  while (true) {
+    if (!(in = get_varint(in, end, &count))) return false;
+    if (count > (size_t)(end-in) || count > len-op) return false;
+    memcpy(out+op, in, count);
+    in += count, op += count;
+    if (!(in = get_varint(in, end, &code))) return false;
+    if (!code) break;
+    if (!(in = get_varint(in, end, &offset))) return false;
+    count = code+LZ_MIN_MATCH-1;
+    if (offset == 0 || offset > op || count > len-op) return false;
+    for (unsigned char *dst=out+op, *src=dst-offset, *stop=dst+count; dst<stop; )
+      *dst++ = *src++;  // byte-by-byte since source and destination may overlap
+    op += count;
+  }
+  return in == end && op == len;
+}
+
+/// Encode a value for storage, compressing it if it is at least `threshold` bytes long and compression makes it smaller.
+// Compressed values start with a marker byte (0xFE), as do uncompressed values that already started with that byte.
+// Use `decompress()` to recover the original value.
+// @function compress
+// @usage _yottadb.compress(value[, threshold])
+// @param value string to encode
+// @param[opt] threshold minimum length of value to try to compress (default 0)
+// @return encoded string
+int lz_compress(lua_State *L) {
+  size_t len;
+  const unsigned char *value = (const unsigned char *)luaL_checklstring(L, 1, &len);
+  lua_Integer threshold = luaL_optinteger(L, 2, 0);
+  if (len >= (size_t)(threshold > 0? threshold: 0) && len > LZ_MIN_MATCH) {
+    unsigned char *out = malloc(2*len + 32);
+    if (!out) luaL_error(L, "Out of memory compressing %d-byte value", (int)len);
+    out[0] = COMPRESSED_MARKER, out[1] = COMPRESSED_LZ;
+    size_t header = 2 + put_varint(out+2, len);
+    size_t out_len = header + lz_encode(value, len, out+header);
+    if (out_len < len) {
+      lua_pushlstring(L, (char *)out, out_len);
+      free(out);
+      return 1;
+    }
+    free(out);
+  }
+  if (len && value[0] == COMPRESSED_MARKER) {
+    // escape an uncompressed value that starts with the marker byte
+    char header[2] = {(char)COMPRESSED_MARKER, COMPRESSED_RAW};
+    lua_pushlstring(L, header, sizeof(header));
+    lua_pushvalue(L, 1);
+    lua_concat(L, 2);
+  } else
+    lua_settop(L, 1);
+  return 1;
+}
+
+/// Decode a value encoded by `compress()`.
+// Values that were not encoded by `compress()` are returned unchanged unless they start with the marker byte (0xFE).
+// Raises an error if compressed data is corrupt.
+// @function decompress
+// @usage _yottadb.decompress(value)
+// @param value encoded string, or `nil`
+// @return original string, or `nil` if value is `nil`
+int lz_decompress(lua_State *L) {
+  lua_settop(L, 1);
+  if (lua_isnil(L, 1)) return 1;
+  size_t len;
+  const unsigned char *value = (const unsigned char *)luaL_checklstring(L, 1, &len);
+  if (len < 2 || value[0] != COMPRESSED_MARKER)
+    return 1;
+  if (value[1] == COMPRESSED_RAW) {
+    lua_pushlstring(L, (char *)value+2, len-2);
+    return 1;
+  }
+  if (value[1] != COMPRESSED_LZ)
+    return 1;
+  size_t out_len;
+  const unsigned char *data = get_varint(value+2, value+len, &out_len);
+  unsigned char *out = data? malloc(out_len? out_len: 1): NULL;
+  if (data && !out) luaL_error(L, "Out of memory decompressing %d-byte value", (int)out_len);
+  bool ok = data && lz_decode(data, value+len, out, out_len);
+  if (ok) lua_pushlstring(L, (char *)out, out_len);
+  free(out);
+  if (!ok) luaL_error(L, "Cannot decompress value: compressed data is corrupt");
+  return 1;
+}
+
+/// @section end
@@ -0,0 +1,21 @@
+// Copyright 2022-2023 Berwyn Hoyt. See LICENSE.
+// Compress node values using a small, fast LZ77 codec
+
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <lua.h>
+
+// First byte of every value stored by `compress()` that is not a plain uncompressed value.
+// The second byte says how the rest is stored: COMPRESSED_LZ or COMPRESSED_RAW (a plain value that happens to start with the marker)
+#define COMPRESSED_MARKER 0xFE
+#define COMPRESSED_LZ 'Z'
+#define COMPRESSED_RAW 'R'
+
+#define LZ_MIN_MATCH 4  /* shortest match worth encoding */
+#define LZ_HASH_BITS 12  /* size of the compressor's match-finding hash table */
+
+int lz_compress(lua_State *L);
+int lz_decompress(lua_State *L);
+
+#endif // COMPRESS_H
@@ -0,0 +1,129 @@
+/// Hash and cache deduplicated blob values.
+// Copyright 2022-2023 Berwyn Hoyt. See LICENSE.
+// @module yottadb.c
+
+/// Deduplication functions
+// @section
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libyottadb.h>
+#include <lua.h>
+#include <lauxlib.h>
+
+#include "yottadb.h"
+#include "dedup.h"
+
+// ~~~ SHA-256 as specified by FIPS 180-4
+
+static const uint32_t sha256_k[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32-(n))))
+
+static void sha256_block(uint32_t state[8], const unsigned char block[64]) {
+  uint32_t w[64];
+  for (int i=0; i<16; i++)
+    w[i] = (uint32_t)block[i*4]<<24 | (uint32_t)block[i*4+1]<<16 | (uint32_t)block[i*4+2]<<8 | block[i*4+3];
+  for (int i=16; i<64; i++) {
+    uint32_t s0 = ROTR(w[i-15], 7) ^ ROTR(w[i-15], 18) ^ (w[i-15] >> 3);
+    uint32_t s1 = ROTR(w[i-2], 17) ^ ROTR(w[i-2], 19) ^ (w[i-2] >> 10);
+    w[i] = w[i-16] + s0 + w[i-7] + s1;
+  }
+  uint32_t a=state[0], b=state[1], c=state[2], d=state[3], e=state[4], f=state[5], g=state[6], h=state[7];
+  for (int i=0; i<64; i++) {
+    uint32_t t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+    uint32_t t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h=g, g=f, f=e, e=d+t1, d=c, c=b, b=a, a=t1+t2;
+  }
+  state[0]+=a, state[1]+=b, state[2]+=c, state[3]+=d, state[4]+=e, state[5]+=f, state[6]+=g, state[7]+=h;
+}
+
+// Write the SHA-256 hash of `len` bytes at `data` into `hex` as DEDUP_HASH_LEN lowercase hex digits (not NUL-terminated)
+static void sha256_hex(const unsigned char *data, size_t len, char hex[DEDUP_HASH_LEN]) {
+  uint32_t state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+  size_t i = 0;
+  for (; i+64 <= len; i+=64)
+    sha256_block(state, data+i);
+  // pad the final partial block with 0x80, zeros, and the message length in bits
+  unsigned char block[128] = {0};
+  size_t rest = len-i;
+  memcpy(block, data+i, rest);
+  block[rest] = 0x80;
+  size_t blocks = rest < 56? 1: 2;
+  uint64_t bits = (uint64_t)len * 8;
+  for (int j=0; j<8; j++)
+    block[blocks*64-1-j] = (unsigned char)(bits >> (j*8));
+  for (size_t j=0; j<blocks; j++)
+    sha256_block(state, block+j*64);
+  static const char digits[] = "0123456789abcdef";
+  for (int j=0; j<32; j++) {
+    unsigned char byte = (unsigned char)(state[j/4] >> (24 - (j%4)*8));
+    hex[j*2] = digits[byte >> 4];
+    hex[j*2+1] = digits[byte & 0xF];
+  }
+}
+
+/// Returns the SHA-256 hash of a string, e.g. to key a deduplicated blob by its content.
+// @function sha256
+// @usage _yottadb.sha256(s)
+// @param s string
+// @return hash as a string of 64 lowercase hex digits
+int sha256(lua_State *L) {
+  size_t len;
+  const unsigned char *s = (const unsigned char *)luaL_checklstring(L, 1, &len);
+  char hex[DEDUP_HASH_LEN];
+  sha256_hex(s, len, hex);
+  lua_pushlstring(L, hex, DEDUP_HASH_LEN);
+  return 1;
+}
+
+// ~~~ Cache of hot blobs, shared by all Lua states in the process.
+// Blobs are keyed by the hash of their content, so a cached blob can never be stale and needs no invalidation.
+// The cache is direct-mapped: each hash has one slot, chosen by its first hex digits, and a new blob replaces the old one.
+
+typedef struct blob_cache_entry {
+  char hash[DEDUP_HASH_LEN];
+  char *value;  // NULL if the slot is empty
+  size_t len;
+} blob_cache_entry;
+
+static blob_cache_entry blob_cache[BLOB_CACHE_ENTRIES];
+
+static inline blob_cache_entry *blob_cache_slot(const char *hash) {
+  return &blob_cache[strtoul((char[]){hash[0], hash[1], hash[2], hash[3], '\0'}, NULL, 16) % BLOB_CACHE_ENTRIES];
+}
+
+// Look up the blob with `hash` (DEDUP_HASH_LEN hex digits) in the cache
+// @return the cached blob and its length in `*len`, or NULL if it is not cached
+const char *blob_cache_get(const char *hash, size_t *len) {
+  blob_cache_entry *entry = blob_cache_slot(hash);
+  if (!entry->value || memcmp(entry->hash, hash, DEDUP_HASH_LEN)) return NULL;
+  *len = entry->len;
+  return entry->value;
+}
+
+// Store a copy of the blob with `hash` (DEDUP_HASH_LEN hex digits) in the cache, unless it is larger than BLOB_CACHE_MAX_LEN
+void blob_cache_put(const char *hash, const char *value, size_t len) {
+  if (len > BLOB_CACHE_MAX_LEN) return;
+  char *copy = malloc(len? len: 1);
+  if (!copy) return;  // caching is optional
+  memcpy(copy, value, len);
+  blob_cache_entry *entry = blob_cache_slot(hash);
+  free(entry->value);
+  memcpy(entry->hash, hash, DEDUP_HASH_LEN);
+  entry->value = copy;
+  entry->len = len;
+}
+
+/// @section end
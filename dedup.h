@@ -0,0 +1,23 @@
+// Copyright 2022-2023 Berwyn Hoyt. See LICENSE.
+// Hash and cache deduplicated blob values
+
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include <stddef.h>
+#include <lua.h>
+
+#include "compress.h"
+
+// A node's value refers to a deduplicated blob if it is COMPRESSED_MARKER, DEDUP_REFERENCE, then the blob's hash
+#define DEDUP_REFERENCE 'H'
+#define DEDUP_HASH_LEN 64  /* length of the hex SHA-256 hash that keys each blob */
+
+#define BLOB_CACHE_ENTRIES 64  /* number of blobs kept in the C-side cache */
+#define BLOB_CACHE_MAX_LEN 65536  /* larger blobs are not cached */
+
+int sha256(lua_State *L);
+const char *blob_cache_get(const char *hash, size_t *len);
+void blob_cache_put(const char *hash, const char *value, size_t len);
+
+#endif // DEDUP_H
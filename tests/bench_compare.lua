@@ -0,0 +1,227 @@
+#!/usr/bin/env lua
+--[[ Record benchmark results to JSON and compare a candidate build against a baseline. Run using:
+    lua tests/bench_compare.lua record <results.json> [runs] [benchmark.lua ...]
+    lua tests/bench_compare.lua <baseline.json> <candidate.json> [threshold_percent]
+  or use 'make bench-record' and 'make bench-compare'.
+  Recording runs each benchmark script `runs` times (default 5) and stores every per-call time of each scenario.
+  Comparing uses the median time of each scenario, and estimates its noise as the median absolute deviation of
+  its runs. A scenario regresses if it is slower than the baseline by more than the threshold (default 5%)
+  and by more than three times the combined noise of both files. Exits with status 1 if any scenario regresses.
+]]
+
+local DEFAULT_RUNS = 5
+local DEFAULT_THRESHOLD = 5
+local DEFAULT_BENCHMARKS = {'tests/mroutine_benchmarks.lua', 'tests/db_benchmarks.lua'}
+
+local lua_exec = 'lua'
+local i=0  while arg[i] do lua_exec = arg[i]  i=i-1  end
+
+-- ~~~ Minimal JSON encoding and decoding of the result files
+
+local function json_string(s)
+  return '"' .. s:gsub('[%c"\\]', function(c)
+    return c=='"' and '\\"' or c=='\\' and '\\\\' or string.format('\\u%04x', c:byte())
+  end) .. '"'
+end
+
+local function json_encode(results, runs)
+  local names = {}
+  for name in pairs(results) do  table.insert(names, name)  end
+  table.sort(names)
+  local lines = {}
+  for _, name in ipairs(names) do
+    local times = {}
+    for j, t in ipairs(results[name]) do  times[j] = string.format('%.4f', t)  end
+    table.insert(lines, string.format('    %s: [%s]', json_string(name), table.concat(times, ', ')))
+  end
+  return string.format('{\n  "runs": %d,\n  "results": {\n%s\n  }\n}\n', runs, table.concat(lines, ',\n'))
+end
+
+-- Decode JSON text into Lua values. Raises an error on malformed input.
+local function json_decode(text)
+  local pos = 1
+  local function fail(expected)  error(string.format("JSON: expected %s at character %d", expected, pos), 0)  end
+  local function skip()  pos = text:find('[^ \t\r\n]', pos) or #text+1  end
+  local value
+  local function literal(word, result)
+    if text:sub(pos, pos+#word-1) ~= word then  fail(word)  end
+    pos = pos + #word
+    return result
+  end
+  local function str()
+    local parts = {}
+    pos = pos + 1  -- skip opening quote
+    while true do
+      local c = text:sub(pos, pos)
+      if c == '' then  fail('closing quote')  end
+      if c == '"' then  pos = pos + 1  break  end
+      if c == '\\' then
+        local e = text:sub(pos+1, pos+1)
+        if e == 'u' then
+          local code = tonumber(text:sub(pos+2, pos+5), 16) or fail('4 hex digits')
+          table.insert(parts, code < 128 and string.char(code) or '?')
+          pos = pos + 6
+        else
+          local escapes = {['"']='"', ['\\']='\\', ['/']='/', b='\b', f='\f', n='\n', r='\r', t='\t'}
+          table.insert(parts, escapes[e] or fail('escape character'))
+          pos = pos + 2
+        end
+      else
+        table.insert(parts, c)
+        pos = pos + 1
+      end
+    end
+    return table.concat(parts)
+  end
+  local function list(close, item)
+    local result = {}
+    pos = pos + 1  -- skip opening bracket
+    skip()
+    if text:sub(pos, pos) == close then  pos = pos + 1  return result  end
+    while true do
+      item(result)
+      skip()
+      local c = text:sub(pos, pos)
+      pos = pos + 1
+      if c == close then  return result  end
+      if c ~= ',' then  pos = pos - 1  fail("',' or '" .. close .. "'")  end
+      skip()
+    end
+  end
+  function value()
+    skip()
+    local c = text:sub(pos, pos)
+    if c == '{' then
+      return list('}', function(result)
+        if text:sub(pos, pos) ~= '"' then  fail('object key')  end
+        local key = str()
+        skip()
+        if text:sub(pos, pos) ~= ':' then  fail("':'")  end
+        pos = pos + 1
+        result[key] = value()
+      end)
+    elseif c == '[' then
+      return list(']', function(result)  table.insert(result, value())  end)
+    elseif c == '"' then  return str()
+    elseif c == 't' then  return literal('true', true)
+    elseif c == 'f' then  return literal('false', false)
+    elseif c == 'n' then  return literal('null', nil)
+    end
+    local number = text:match('^-?%d+%.?%d*[eE]?[-+]?%d*', pos)
+    if not number or not tonumber(number) then  fail('value')  end
+    pos = pos + #number
+    return tonumber(number)
+  end
+  local result = value()
+  skip()
+  if pos <= #text then  fail('end of input')  end
+  return result
+end
+
+-- ~~~ Statistics
+
+local function median(values)
+  local sorted = {}
+  for j, v in ipairs(values) do  sorted[j] = v  end
+  table.sort(sorted)
+  local n = #sorted
+  if n % 2 == 1 then  return sorted[(n+1)/2]  end
+  return (sorted[n/2] + sorted[n/2+1]) / 2
+end
+
+-- Return the median of `times` and the noise as the median absolute deviation from it
+local function summarise(times)
+  local mid = median(times)
+  local deviations = {}
+  for j, t in ipairs(times) do  deviations[j] = math.abs(t - mid)  end
+  return mid, median(deviations)
+end
+
+-- ~~~ Commands
+
+-- Run each benchmark script `runs` times and write the per-call times of each scenario to `filename` as JSON.
+-- Scenarios are lines of benchmark output like: 1.23us (1.0x) description
+local function record(filename, runs, scripts)
+  local results = {}
+  for run = 1, runs do
+    for _, script in ipairs(scripts) do
+      io.stderr:write(string.format("Run %d/%d: %s\n", run, runs, script))
+      local pipe = assert(io.popen(lua_exec .. ' ' .. script))
+      local prefix = script:match('([^/]+)%.lua$') or script
+      for line in pipe:lines() do
+        local t, description = line:match('^([0-9.]+)us %([^)]*%)\t(.*)$')
+        if t then
+          local name = prefix .. ': ' .. description
+          results[name] = results[name] or {}
+          table.insert(results[name], tonumber(t))
+        end
+      end
+      local ok = pipe:close()
+      if not ok then  error(string.format("benchmark %s failed", script), 0)  end
+    end
+  end
+  local file = assert(io.open(filename, 'w'))
+  file:write(json_encode(results, runs))
+  file:close()
+end
+
+local function load_results(filename)
+  local file = assert(io.open(filename))
+  local text = file:read('*a')
+  file:close()
+  local ok, data = pcall(json_decode, text)
+  if not ok then  error(string.format("%s: %s", filename, data), 0)  end
+  if type(data) ~= 'table' or type(data.results) ~= 'table' then
+    error(string.format("%s: no 'results' object found", filename), 0)
+  end
+  return data.results
+end
+
+-- Compare candidate results against baseline results and return the number of regressions
+local function compare(baseline_file, candidate_file, threshold)
+  local baseline, candidate = load_results(baseline_file), load_results(candidate_file)
+  local names = {}
+  for name in pairs(baseline) do  table.insert(names, name)  end
+  table.sort(names)
+  local regressions = 0
+  io.write(string.format("%10s %10s %8s %7s  %s\n", 'baseline', 'candidate', 'delta', 'noise', 'scenario'))
+  for _, name in ipairs(names) do
+    if not candidate[name] then
+      io.write(string.format("%10s %10s %8s %7s  %s\n", '', 'missing', '', '', name))
+    else
+      local base, base_noise = summarise(baseline[name])
+      local cand, cand_noise = summarise(candidate[name])
+      local delta = base > 0 and (cand/base - 1) * 100 or 0
+      local noise = base > 0 and math.sqrt(base_noise^2 + cand_noise^2) / base * 100 or 0
+      local regressed = delta > threshold and delta > 3*noise
+      if regressed then  regressions = regressions + 1  end
+      io.write(string.format("%8.2fus %8.2fus %+7.1f%% %6.1f%%  %s%s\n",
+        base, cand, delta, noise, name, regressed and '  <-- REGRESSION' or ''))
+    end
+  end
+  for name in pairs(candidate) do
+    if not baseline[name] then  io.write(string.format("%10s %10s %8s %7s  %s\n", 'new', '', '', '', name))  end
+  end
+  io.write(string.format("\n%d scenario(s) regressed by more than %g%% beyond noise\n", regressions, threshold))
+  return regressions
+end
+
+local function usage()
+  io.stderr:write("Usage:\n")
+  io.stderr:write("  lua tests/bench_compare.lua record <results.json> [runs] [benchmark.lua ...]\n")
+  io.stderr:write("  lua tests/bench_compare.lua <baseline.json> <candidate.json> [threshold_percent]\n")
+  os.exit(2)
+end
+
+if arg[1] == 'record' then
+  if not arg[2] then  usage()  end
+  local runs = tonumber(arg[3]) or DEFAULT_RUNS
+  local scripts = {select(4, (table.unpack or unpack)(arg))}
+  if #scripts == 0 then  scripts = DEFAULT_BENCHMARKS  end
+  record(arg[2], runs, scripts)
+elseif arg[1] and arg[2] then
+  local threshold = tonumber(arg[3] or DEFAULT_THRESHOLD) or usage()
+  os.exit(compare(arg[1], arg[2], threshold) > 0 and 1 or 0)
+else
+  usage()
+end
@@ -0,0 +1,224 @@
+// Microbenchmarks of the C hot paths in _yottadb.so, timed in CPU cycles without Lua interpreter overhead.
+// Copyright 2022-2023 Berwyn Hoyt. See LICENSE.
+//
+// Build and run using:
+//     make c-benchmarks
+//
+// Only luaopen__yottadb() is exported from _yottadb.so, so the C functions under test are fetched from
+// the module table it returns and then called directly as C functions on a prepared Lua stack.
+// Each benchmark times its stack preparation separately and subtracts it, so that only the called function is measured.
+// Internal helpers are measured through the functions that call them:
+//   * getsubs and _cachearray_create() as the difference between data(varname, ...) and data(cachearray)
+//   * cast2ydb() and cast2lua() as the difference between cip() calls with string parameters and with none
+
+#define _POSIX_C_SOURCE 200809L  // for clock_gettime()
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+#endif
+
+#include <lua.h>
+#include <lauxlib.h>
+#include <lualib.h>
+
+int luaopen__yottadb(lua_State *L);
+
+#if LUA_VERSION_NUM < 502
+  #define lua_rawlen lua_objlen
+#endif
+
+#define ITERATIONS 200000
+#define REPEATS 5
+
+// Return a timestamp in CPU cycles where available, otherwise in nanoseconds
+static inline uint64_t timestamp(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec*1000000000 + t.tv_nsec;
+#endif
+}
+#if defined(__x86_64__) || defined(__i386__)
+  #define UNITS "cycles"
+#else
+  #define UNITS "ns"
+#endif
+
+// A benchmark pushes the arguments of `func` onto the stack. If `func` is NULL, only the arguments are pushed.
+typedef void (*setup_t)(lua_State *L);
+
+// Return the minimum over REPEATS runs of the mean time taken to call setup() and then func()
+static double time_call(lua_State *L, setup_t setup, lua_CFunction func, int iterations) {
+  double best = 1e300;
+  int top = lua_gettop(L);
+  for (int r = 0; r < REPEATS; r++) {
+    uint64_t start = timestamp();
+    for (int i = 0; i < iterations; i++) {
+      setup(L);
+      if (func) func(L);
+      lua_settop(L, top);
+    }
+    double mean = (double)(timestamp() - start) / iterations;
+    if (mean < best) best = mean;
+  }
+  return best;
+}
+
+// Print the time taken by func() alone, i.e. excluding the time taken to prepare its stack
+static double bench(lua_State *L, const char *name, setup_t setup, lua_CFunction func, int iterations) {
+  double overhead = time_call(L, setup, NULL, iterations);
+  double total = time_call(L, setup, func, iterations);
+  printf("%10.1f %s\t%s\n", total-overhead, UNITS, name);
+  fflush(stdout);
+  return total-overhead;
+}
+
+// Fetch C function `name` from the _yottadb module table at stack index 1
+static lua_CFunction cfunction(lua_State *L, const char *name) {
+  lua_getfield(L, 1, name);
+  lua_CFunction func = lua_tocfunction(L, -1);
+  if (!func) luaL_error(L, "_yottadb.%s is not a C function", name);
+  lua_pop(L, 1);
+  return func;
+}
+
+static void setup_create(lua_State *L) {
+  lua_pushstring(L, "bench");
+  lua_pushstring(L, "sub1");
+  lua_pushstring(L, "sub2");
+  lua_pushstring(L, "sub3");
+}
+static void setup_create_table(lua_State *L) {
+  lua_pushstring(L, "bench");
+  lua_getglobal(L, "subs");
+}
+static void setup_append(lua_State *L) {
+  lua_getglobal(L, "node");
+  lua_pushstring(L, "child");
+}
+static void setup_subst(lua_State *L) {
+  lua_getglobal(L, "mutable");
+  lua_pushstring(L, "sibling");
+}
+static void setup_data_cachearray(lua_State *L) {
+  lua_getglobal(L, "node");
+}
+static void setup_data_varname(lua_State *L) {
+  setup_create(L);
+}
+static void setup_data_table(lua_State *L) {
+  setup_create_table(L);
+}
+
+// Push the arguments captured in global table `name` by capture_cip() in the Lua setup code
+static void push_captured(lua_State *L, const char *name) {
+  lua_getglobal(L, name);
+  int n = lua_rawlen(L, -1);
+  for (int i = 1; i <= n; i++) {
+    lua_rawgeti(L, -i, i);
+  }
+  lua_remove(L, -n-1);
+}
+static void setup_cip_ret(lua_State *L) { push_captured(L, "cip_ret"); }
+static void setup_cip_echo_string(lua_State *L) { push_captured(L, "cip_echo_string"); }
+static void setup_cip_echo_buffer(lua_State *L) { push_captured(L, "cip_echo_buffer"); }
+static void setup_cip_fill_string(lua_State *L) { push_captured(L, "cip_fill_string"); }
+static void setup_cip_fill_string100(lua_State *L) { push_captured(L, "cip_fill_string100"); }
+static void setup_cip_fill_buffer(lua_State *L) { push_captured(L, "cip_fill_buffer"); }
+static void setup_cip_fill_buffer100(lua_State *L) { push_captured(L, "cip_fill_buffer100"); }
+
+// Lua code to create the nodes used by the benchmarks and capture the arguments that M routine wrappers pass to cip()
+static const char *setup_code =
+  "_yottadb = require '_yottadb'\n"
+  "ydb = require 'yottadb'\n"
+  "subs = {'sub1', 'sub2', 'sub3'}\n"
+  "node = _yottadb.cachearray_create('bench', 'sub1', 'sub2', 'sub3')\n"
+  "mutable = _yottadb.cachearray_tomutable(_yottadb.cachearray_create('bench', 'sub1', 'sub2', 'sub3'))\n"
+  "ydb.set('$ZROUTINES', '. tests')\n"
+  "local routines = ydb.require([[\n"
+  "  ret: void ret^unittest()\n"
+  "  echo_string: ydb_string_t* echo^unittest(I:ydb_string_t*)\n"
+  "  echo_buffer: ydb_string_t* echo^unittest(I:ydb_buffer_t*)\n"
+  "  fill_string: void fill^unittest(I:ydb_long_t, O:ydb_string_t*)\n"
+  "  fill_string100: void fill^unittest(I:ydb_long_t, O:ydb_string_t*[100])\n"
+  "  fill_buffer: void fill^unittest(I:ydb_long_t, O:ydb_buffer_t*)\n"
+  "  fill_buffer100: void fill^unittest(I:ydb_long_t, O:ydb_buffer_t*[100])\n"
+  "]])\n"
+  "local cip = _yottadb.cip\n"
+  "local function capture_cip(name, ...)\n"
+  "  _yottadb.cip = function(...)  _G['cip_'..name] = {...}  end\n"
+  "  routines[name](...)\n"
+  "  _yottadb.cip = cip\n"
+  "end\n"
+  "local s = string.rep('x', 100)\n"
+  "capture_cip('ret')\n"
+  "capture_cip('echo_string', s)\n"
+  "capture_cip('echo_buffer', s)\n"
+  "for _, name in ipairs{'fill_string', 'fill_string100', 'fill_buffer', 'fill_buffer100'} do  capture_cip(name, 100)  end\n";
+
+static int run(lua_State *L) {
+  lua_settop(L, 0);
+  // Make require('_yottadb') return this module rather than loading another copy of _yottadb.so
+  lua_getglobal(L, "package");
+  lua_getfield(L, -1, "preload");
+  lua_pushcfunction(L, luaopen__yottadb);
+  lua_setfield(L, -2, "_yottadb");
+  lua_pop(L, 2);
+  if (luaL_dostring(L, setup_code)) lua_error(L);
+  lua_getglobal(L, "_yottadb");
+  // STACK: _yottadb
+  lua_CFunction create = cfunction(L, "cachearray_create");
+  lua_CFunction append = cfunction(L, "cachearray_append");
+  lua_CFunction subst = cfunction(L, "cachearray_subst");
+  lua_CFunction data = cfunction(L, "data");
+  lua_CFunction cip = cfunction(L, "cip");
+  lua_settop(L, 0);  // the functions under test take their arguments from stack index 1
+  // STACK: (empty)
+
+  printf("Times per call in " UNITS ", excluding the time to push its arguments\n");
+  bench(L, "cachearray_create('bench', 'sub1', 'sub2', 'sub3')", setup_create, create, ITERATIONS);
+  bench(L, "cachearray_create('bench', {'sub1', 'sub2', 'sub3'})", setup_create_table, create, ITERATIONS);
+  bench(L, "cachearray_append(cachearray, 'child')", setup_append, append, ITERATIONS);
+  bench(L, "cachearray_subst(mutable_cachearray, 'sibling')", setup_subst, subst, ITERATIONS);
+  printf("\n");
+
+  double base = bench(L, "data(cachearray)", setup_data_cachearray, data, ITERATIONS);
+  double with_getsubs = bench(L, "data('bench', 'sub1', 'sub2', 'sub3')", setup_data_varname, data, ITERATIONS);
+  printf("%10.1f %s\t=> getsubs of 3 subscript arguments\n", with_getsubs-base, UNITS);
+  with_getsubs = bench(L, "data('bench', {'sub1', 'sub2', 'sub3'})", setup_data_table, data, ITERATIONS);
+  printf("%10.1f %s\t=> getsubs of 3 subscripts in a table\n", with_getsubs-base, UNITS);
+  printf("\n");
+
+  base = bench(L, "cip() of ret^unittest with no parameters", setup_cip_ret, cip, ITERATIONS/4);
+  struct { const char *name; setup_t setup; } casts[] = {
+    {"I:ydb_string_t* of 100 bytes and ydb_string_t* return", setup_cip_echo_string},
+    {"I:ydb_buffer_t* of 100 bytes and ydb_string_t* return", setup_cip_echo_buffer},
+    {"O:ydb_string_t* of 100 bytes", setup_cip_fill_string},
+    {"O:ydb_string_t*[100] of 100 bytes", setup_cip_fill_string100},
+    {"O:ydb_buffer_t* of 100 bytes", setup_cip_fill_buffer},
+    {"O:ydb_buffer_t*[100] of 100 bytes", setup_cip_fill_buffer100},
+  };
+  for (size_t i = 0; i < sizeof(casts)/sizeof(casts[0]); i++) {
+    char name[128];
+    snprintf(name, sizeof(name), "cip() with %s", casts[i].name);
+    double total = bench(L, name, casts[i].setup, cip, ITERATIONS/4);
+    printf("%10.1f %s\t=> cast2ydb() and cast2lua() of %s\n", total-base, UNITS, casts[i].name);
+  }
+  return 0;
+}
+
+int main(void) {
+  lua_State *L = luaL_newstate();
+  luaL_openlibs(L);
+  lua_pushcfunction(L, run);
+  int status = lua_pcall(L, 0, 0, 0);
+  if (status != 0)
+    fprintf(stderr, "%s\n", lua_tostring(L, -1));
+  lua_close(L);
+  return status != 0;
+}
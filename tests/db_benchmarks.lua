@@ -0,0 +1,52 @@
+#!/usr/bin/env lua
+--[[ Test the speed of common database operations, which exercise the C hot paths:
+  subscript marshalling (getsubs), cachearray creation and value casting. Run using:
+    make benchmarks
+  This is also the training workload for profile-guided optimisation by 'make pgo'.
+]]
+
+ydb = require 'yottadb'
+
+local function time(code, count)
+    task = load([[
+        local start = os.clock()
+        for i=1, ]] .. count .. [[ do ]] .. code .. [[ end
+        return os.clock() - start
+    ]])
+    return task()
+end
+
+local function show(result, first, name)
+    io.write(string.format("%0.2fus (%.1fx)\t%s\n", result, result/first, name))
+end
+
+ydb.init()
+ydb.kill('bench')
+bench = ydb.node('bench')
+
+first = time('ydb.set("bench", "a", i, i)', 1000000)
+show(first, first, "Set local with 2 subscripts")
+result = time('ydb.get("bench", "a", i)', 1000000)
+show(result, first, "Get local with 2 subscripts")
+result = time('ydb.get("bench", {"a", i})', 1000000)
+show(result, first, "Get local with 2 subscripts in a table")
+result = time('ydb.data("bench", "a", i)', 1000000)
+show(result, first, "Data of local with 2 subscripts")
+result = time('ydb.incr("bench", {"count"})', 1000000)
+show(result, first, "Increment local with 1 subscript")
+io.write('\n')
+
+first = time('bench("a", i)', 1000000)
+show(first, first, "Create node with 2 subscripts")
+result = time('bench.a[i]', 1000000)
+show(result, first, "Create node with 2 subscripts using dot notation")
+result = time('bench("a", i):__get()', 1000000)
+show(result, first, "Create node and get its value")
+result = time('bench("b", i):__set(i)', 1000000)
+show(result, first, "Create node and set its value")
+result = time('for k, v in pairs(bench.a) do end', 1)
+show(result, first, "Iterate subnodes (per subnode of 1M)")
+result = time('ydb.str2zwr("value")', 1000000)
+show(result, first, "Convert a string to ZWRITE format")
+
+ydb.kill('bench')
@@ -5,10 +5,31 @@
 
 ydb = require 'yottadb'
 
+-- String sizes to benchmark, each with the number of calls to time
+sizes = {{10, 1000000}, {1000, 100000}, {100000, 10000}}
+
 ci_table = [=[
   ret: void ret^unittest()
   add: ydb_long_t* add^unittest(I:ydb_int_t, I:ydb_uint_t, I:ydb_long_t, I:ydb_ulong_t, I:ydb_int_t*, I:ydb_uint_t*, I:ydb_long_t*, I:ydb_ulong_t*)
+  echo_char: ydb_string_t* echo^unittest(I:ydb_char_t*)
+  echo_string: ydb_string_t* echo^unittest(I:ydb_string_t*)
+  echo_buffer: ydb_string_t* echo^unittest(I:ydb_buffer_t*)
+  fill_char: void fill^unittest(I:ydb_long_t, O:ydb_char_t*)
+  fill_string: void fill^unittest(I:ydb_long_t, O:ydb_string_t*)
+  fill_buffer: void fill^unittest(I:ydb_long_t, O:ydb_buffer_t*)
+  reverse_char: void reverse^unittest(IO:ydb_char_t*)
+  reverse_string: void reverse^unittest(IO:ydb_string_t*)
+  reverse_buffer: void reverse^unittest(IO:ydb_buffer_t*)
 ]=]
+-- Also define output routines with [n] preallocation that exactly fits each size
+for _, size in ipairs(sizes) do
+  ci_table = ci_table .. string.format([=[
+  fill_string%d: void fill^unittest(I:ydb_long_t, O:ydb_string_t*[%d])
+  fill_buffer%d: void fill^unittest(I:ydb_long_t, O:ydb_buffer_t*[%d])
+  reverse_string%d: void reverse^unittest(IO:ydb_string_t*[%d])
+  reverse_buffer%d: void reverse^unittest(IO:ydb_buffer_t*[%d])
+]=], size[1], size[1], size[1], size[1], size[1], size[1], size[1], size[1])
+end
 
 ydb.set("$ZROUTINES", ". tests")
 routines = ydb.require(ci_table)
@@ -26,6 +47,11 @@ local function show(result, first, name)
     io.write(string.format("%0.2fus (%.1fx)\t%s\n", result, result/first, name))
 end
 
+-- Return the time per call in microseconds of running `code` `count` times
+local function time_per_call(code, count)
+    return time(code, count) * 1000000 / count
+end
+
 ydb.init()
 first = time('routines.ret()', 1000000)
 show(first, first, "Empty M routine call+return with 0 params")
@@ -40,3 +66,35 @@ show(first, first, "Empty M routine call+return with 8 params")
 ydb.init(ydb.block_M_signals)
 result = time('routines.add(1,2,3,4,5,6,7,8)', 1000000)
 show(result, first, "Empty M routine call+return with 8 params with signal blocking")
+io.write('\n')
+
+-- String parameters: inputs are copied in; outputs without [n] preallocation allocate YDB_MAX_STR per call
+ydb.init()
+for _, size in ipairs(sizes) do
+    local length, count = size[1], size[2]
+    s = string.rep('x', length)
+    n = length
+    first = time_per_call('routines.echo_char(s)', count)
+    show(first, first, string.format("Return %d-byte string from I:ydb_char_t* param", length))
+    result = time_per_call('routines.echo_string(s)', count)
+    show(result, first, string.format("Return %d-byte string from I:ydb_string_t* param", length))
+    result = time_per_call('routines.echo_buffer(s)', count)
+    show(result, first, string.format("Return %d-byte string from I:ydb_buffer_t* param", length))
+    for _, typ in ipairs{'char', 'string', 'buffer'} do
+        result = time_per_call('routines.fill_' .. typ .. '(n)', count)
+        show(result, first, string.format("Output %d-byte O:ydb_%s_t* param", length, typ))
+        if typ ~= 'char' then  -- ydb_char_t* outputs are always preallocated to YDB_MAX_STR
+            result = time_per_call('routines.fill_' .. typ .. length .. '(n)', count)
+            show(result, first, string.format("Output %d-byte O:ydb_%s_t*[%d] param", length, typ, length))
+        end
+    end
+    for _, typ in ipairs{'char', 'string', 'buffer'} do
+        result = time_per_call('routines.reverse_' .. typ .. '(s)', count)
+        show(result, first, string.format("Modify %d-byte IO:ydb_%s_t* param", length, typ))
+        if typ ~= 'char' then
+            result = time_per_call('routines.reverse_' .. typ .. length .. '(s)', count)
+            show(result, first, string.format("Modify %d-byte IO:ydb_%s_t*[%d] param", length, typ, length))
+        end
+    end
+    io.write('\n')
+end
@@ -324,6 +324,58 @@ function test_data()
   validate_subsarray_inputs(_yottadb.data)
 end
 
+function test_data_many()
+  simple_data()
+  local cache_create = _yottadb.cachearray_create
+  local nodes = {cache_create('^nodata'), cache_create('^test1'), cache_create('^test2'), cache_create('^test3', 'sub1')}
+  local results = _yottadb.data_many(nodes)
+  asserteq(#results, 4)
+  asserteq(results[1], _yottadb.YDB_DATA_UNDEF)
+  asserteq(results[2], _yottadb.YDB_DATA_VALUE_NODESC)
+  asserteq(results[3], _yottadb.YDB_DATA_NOVALUE_DESC)
+  asserteq(results[4], _yottadb.YDB_DATA_VALUE_DESC)
+  asserteq(#_yottadb.data_many({}), 0)
+
+  -- high level version accepts a mixture of nodes and {varname, subsarray} tables
+  results = yottadb.data_many({yottadb.node('^test3', 'sub1', 'sub2'), {'^test2', {'sub1'}}, {'^nodata'}})
+  asserteq(results[1], _yottadb.YDB_DATA_VALUE_NODESC)
+  asserteq(results[2], _yottadb.YDB_DATA_VALUE_NODESC)
+  asserteq(results[3], _yottadb.YDB_DATA_UNDEF)
+
+  -- Validate inputs.
+  local ok, e = pcall(_yottadb.data_many, 'abc')
+  assert(not ok)  assert(e:find('table of'))
+  ok, e = pcall(_yottadb.data_many, {cache_create('^test1'), '^test2'})
+  assert(not ok)  assert(e:find('must all be cachearrays'))
+  ok, e = pcall(yottadb.data_many, {yottadb.node('^test1'), true})
+  assert(not ok)  assert(e:find('node or table expected at index 2'))
+end
+
+function test_kill_many()
+  simple_data()
+  local cache_create = _yottadb.cachearray_create
+  -- delete node values only
+  _yottadb.kill_many({cache_create('^test3'), cache_create('^test4', 'sub1')}, _yottadb.YDB_DEL_NODE)
+  asserteq(_yottadb.data('^test3'), _yottadb.YDB_DATA_NOVALUE_DESC)
+  asserteq(_yottadb.data('^test4', {'sub1'}), _yottadb.YDB_DATA_NOVALUE_DESC)
+  -- delete whole trees
+  _yottadb.kill_many({cache_create('^test3'), cache_create('^test4', 'sub1')}, _yottadb.YDB_DEL_TREE)
+  asserteq(_yottadb.data('^test3'), _yottadb.YDB_DATA_UNDEF)
+  asserteq(_yottadb.data('^test4', {'sub1'}), _yottadb.YDB_DATA_UNDEF)
+  asserteq(_yottadb.get('^test4', {'sub2'}), 'test4sub2')
+
+  -- high level version kills trees
+  yottadb.kill_many({yottadb.node('^test4', 'sub2'), {'^test6', {'sub6'}}})
+  asserteq(_yottadb.data('^test4', {'sub2'}), _yottadb.YDB_DATA_UNDEF)
+  asserteq(_yottadb.data('^test6'), _yottadb.YDB_DATA_UNDEF)
+  asserteq(_yottadb.get('^test4', {'sub3'}), 'test4sub3')
+
+  -- Validate inputs: nothing must be deleted if any node is invalid
+  local ok, e = pcall(_yottadb.kill_many, {cache_create('^test4'), 'abc'}, _yottadb.YDB_DEL_TREE)
+  assert(not ok)  assert(e:find('must all be cachearrays'))
+  asserteq(_yottadb.get('^test4'), 'test4')
+end
+
 -- Note: for some reason, this test must be run first to pass.
 function test_lock_incr()
   local diff
@@ -1099,6 +1151,13 @@ function test_str2zwr()
     asserteq(_yottadb.str2zwr(input), (os.getenv('ydb_chset') == 'UTF-8' and output2 or output1))
   end
 
+  -- Printable ASCII is formatted natively, so check it matches YDB's rules, including for quotes and empty strings
+  asserteq(_yottadb.str2zwr(''), '""')
+  asserteq(_yottadb.str2zwr('say "hi"'), '"say ""hi"""')
+  asserteq(_yottadb.str2zwr('"'), '""""')
+  asserteq(_yottadb.str2zwr(' ~'), '" ~"')
+  asserteq(_yottadb.str2zwr('a\127'), '"a"_$C(127)')
+
   -- Validate inputs.
   local ok, e = pcall(_yottadb.str2zwr, true)
   assert(not ok)
@@ -1118,6 +1177,9 @@ function test_zwr2str()
     local input, output = t[3], t[1]
     asserteq(_yottadb.zwr2str(input), output)
   end
+  asserteq(_yottadb.zwr2str('""'), '')
+  asserteq(_yottadb.zwr2str('"say ""hi"""'), 'say "hi"')
+  asserteq(_yottadb.zwr2str('"a"_"b"'), 'ab')
 
   -- Validate inputs.
   local ok, e = pcall(_yottadb.zwr2str, true)
@@ -1132,6 +1194,29 @@ function test_zwr2str()
   --assert(yottadb.get_error_code(e) ~= _yottadb.YDB_OK)
 end
 
+function test_str2zwr_many()
+  local strings, zwrs = {}, {}
+  local zwr_output = os.getenv('ydb_chset') == 'UTF-8' and 3 or 2
+  for i, t in ipairs(str2zwr_tests) do  strings[i], zwrs[i] = t[1], t[zwr_output]  end
+  table.insert(strings, 'say "hi"')  table.insert(zwrs, '"say ""hi"""')
+  table.insert(strings, '')  table.insert(zwrs, '""')
+  local results = yottadb.str2zwr_many(strings)
+  asserteq(#results, #strings)
+  for i = 1, #strings do  asserteq(results[i], zwrs[i])  end
+  results = yottadb.zwr2str_many(zwrs)
+  asserteq(#results, #zwrs)
+  for i = 1, #zwrs do  asserteq(results[i], strings[i])  end
+  asserteq(#yottadb.str2zwr_many({}), 0)
+
+  -- Validate inputs.
+  local ok, e = pcall(yottadb.str2zwr_many, 'abc')
+  assert(not ok)
+  assert(e:find('table expected'))
+  ok, e = pcall(yottadb.zwr2str_many, {'"a"', true})
+  assert(not ok)
+  assert(e:find('string expected at index 2'))
+end
+
 function test_get_error_code()
   -- if user is using strict.lua, allow the following pcall to work without creating an error
   local mt = getmetatable(_G)
@@ -1540,6 +1625,24 @@ function test_key_delete()
   asserteq(testkey.data, 0)
 end
 
+function test_key_attributes_collected()
+  local function count_key_values()
+    local count = 0
+    for _ in pairs(yottadb._key_values) do  count = count + 1  end
+    return count
+  end
+  collectgarbage() collectgarbage()
+  local initial = count_key_values()
+  for i = 1, 100 do
+    local key = yottadb.key('test4')
+    key.attribute = i  -- stored in key_values
+    key:subscript_next()  -- stores __next_cachearray
+  end
+  assert(count_key_values() > initial)
+  collectgarbage() collectgarbage()
+  asserteq(count_key_values(), initial)
+end
+
 function test_key_lock()
   local key = yottadb.key('test1')('sub1')('sub2')
   elapsed(0)
@@ -1926,6 +2029,731 @@ function test_pairs()
   asserteq(i, 0)
 end
 
+function test_typed_subscripts()
+  local ord = yottadb.node('^ORD')
+  local subscripts = {'abc', '2', '10', '-3', '.5', '01', '-.25', '0', '123456789012345678', '1234567890123456789', '1.5e3'}
+  for _, sub in ipairs(subscripts) do  ord(sub).__ = sub  end
+  local expected = {-3, -0.25, 0, 0.5, 2, 10, 123456789012345678, '01', '1.5e3', '1234567890123456789', 'abc'}
+  if lua_version < 5.3 then  expected[7] = '123456789012345678'  end  -- too many digits for a Lua 5.1/5.2 double
+
+  -- check node:subscripts()
+  local i = 0
+  for sub in ord:subscripts(false, true) do
+    i = i+1
+    asserteq(type(sub), type(expected[i]))
+    asserteq(sub, expected[i])
+  end
+  asserteq(i, #expected)
+  if lua_version >= 5.3 then
+    local iterator = ord:subscripts(false, true)
+    asserteq(math.type(iterator()), 'integer')
+    asserteq(math.type(iterator()), 'float')
+  end
+  -- check reverse and untyped iteration is unaffected
+  i = #expected
+  for sub in ord:subscripts(true, true) do  asserteq(sub, expected[i])  i = i-1  end
+  asserteq(i, 0)
+  for sub in ord:subscripts() do  asserteq(type(sub), 'string')  end
+
+  -- check node:pairs() also returns the node and value
+  i = 0
+  for subnode, value, sub in ord:__pairs(false, true) do
+    i = i+1
+    asserteq(sub, expected[i])
+    asserteq(value, _yottadb.cachearray_subscript(subnode, -1))
+  end
+  asserteq(i, #expected)
+
+  -- check node_next()
+  local next_subs = _yottadb.node_next(ord, true)
+  asserteq(next_subs[1], -3)
+  next_subs = yottadb.node_next(ord('10'), true)
+  asserteq(next_subs[1], 123456789012345678)
+  asserteq(_yottadb.node_next(ord)[1], '-3')
+  asserteq(yottadb.node_previous(ord('abc'), true)[1], '1234567890123456789')
+  ord:kill()
+end
+
+function test_merge_iter()
+  local m1, m2, m3 = yottadb.node('merge1'), yottadb.node('merge2'), yottadb.node('merge3')('sub')
+  for _, sub in ipairs{'b', '10', 'a', '-1'} do  m1(sub).__ = 1  end
+  for _, sub in ipairs{'b', '2', '.5', 'c'} do  m2(sub).__ = 1  end
+  for _, sub in ipairs{'10', '1.5e3', 'b'} do  m3(sub):set(1)  end
+  m3('1.5e3')('deeper'):set(1)  -- must not be iterated
+  local expected = {{'-1', {1}}, {'.5', {2}}, {'2', {2}}, {'10', {1, 3}}, {'1.5e3', {3}}, {'a', {1}}, {'b', {1, 2, 3}}, {'c', {2}}}
+  local i = 0
+  for sub, sources in yottadb.merge_iter({m1, m2, {'merge3', {'sub'}}}) do
+    i = i + 1
+    asserteq(sub, expected[i][1])
+    asserteq(table.concat(sources, ','), table.concat(expected[i][2], ','))
+  end
+  asserteq(i, #expected)
+
+  -- check reverse order
+  for sub, sources in yottadb.merge_iter({m1, m2, m3}, true) do
+    asserteq(sub, expected[i][1])
+    asserteq(table.concat(sources, ','), table.concat(expected[i][2], ','))
+    i = i - 1
+  end
+  asserteq(i, 0)
+
+  -- check empty sources and long subscripts that need a larger buffer
+  local long = string.rep('x', 1000)
+  m2(long).__ = 1
+  local subs = {}
+  for sub, sources in yottadb.merge_iter({yottadb.node('merge_empty'), m2}) do
+    asserteq(sources[1], 2)
+    table.insert(subs, sub)
+  end
+  asserteq(table.concat(subs, ','), table.concat({'.5', '2', 'b', 'c', long}, ','))
+  for _ in yottadb.merge_iter({}) do  error('no subscripts expected')  end
+
+  -- sources are listed in ascending order regardless of heap layout
+  local many = {}
+  for n = 1, 7 do
+    many[n] = yottadb.node('merge_many', n)
+    many[n]('x'):set(1)
+    many[n](n):set(1)
+  end
+  for sub, sources in yottadb.merge_iter(many) do
+    if sub == 'x' then  asserteq(table.concat(sources, ','), '1,2,3,4,5,6,7')  end
+  end
+  yottadb.kill('merge_many')
+
+  local ok, e = pcall(yottadb.merge_iter, {m1, 'merge2'})
+  assert(not ok)
+  assert(e:find('node or table expected at index 2'))
+  m1:kill()  m2:kill()  m3:kill()
+end
+
+function test_partitioned()
+  asserteq(_yottadb.hash(''), 2166136261)
+  asserteq(_yottadb.hash('a'), 0xe40c292c)  -- FNV-1a reference value
+  local parts = yottadb.partitioned({'part1', yottadb.node('part2'), 'part3'})
+  parts:kill()
+  local names = {'alice', 'bob', 'carol', 'dave', 'eve', 'frank', 'grace', 10, 2}
+  for i, name in ipairs(names) do
+    parts(name).age.__ = i
+    parts(name, 'city'):set('x')
+  end
+  -- keys must be spread over more than one partition, each in the partition chosen by the hash
+  local used = {}
+  for i, name in ipairs(names) do
+    local index = parts:partition(name)
+    asserteq(yottadb.node('part'..index)(name).age.__, tostring(i))
+    used[index] = true
+  end
+  asserteq(#used, 3)  -- these names happen to hash to all three partitions
+  asserteq(parts(names[1]):varname(), 'part'..parts:partition(names[1]))
+  -- keys that M treats as the same subscript are in the same partition and node
+  asserteq(parts:partition(1.0), parts:partition(1))
+  asserteq(parts:partition(0.5), parts:partition('.5'))
+  asserteq(parts(0.5), parts('.5'))
+
+  asserteq(parts:count(), #names)
+  asserteq(parts:sum('age'), #names*(#names+1)/2)
+  asserteq(parts:sum(), 0)  -- keys have no value of their own
+  asserteq(parts:reduce(function(n, subnode, key)  return n + #tostring(key)  end, 0), 33)
+
+  local keys = {}
+  for subnode, value, key in pairs(parts) do
+    asserteq(subnode, parts(key))
+    asserteq(value, nil)
+    table.insert(keys, key)
+  end
+  asserteq(table.concat(keys, ','), '2,10,alice,bob,carol,dave,eve,frank,grace')
+  keys = {}
+  for subnode, value, key in parts:pairs(true) do  table.insert(keys, key)  end
+  asserteq(table.concat(keys, ','), 'grace,frank,eve,dave,carol,bob,alice,10,2')
+
+  parts:kill()
+  asserteq(parts:count(), 0)
+  assert(not pcall(yottadb.partitioned, {}))
+end
+
+function test_timebuckets()
+  local log = yottadb.timebuckets('tblog', {bucket='hour', retain=2*3600})
+  log:kill()
+  local t0 = 1700000000 - 1700000000%3600  -- start of an hour
+  asserteq(log:bucket(t0+3599), t0)
+  asserteq(log:bucket(t0+3600), t0+3600)
+  local bucket, seq = log:append('a', t0+10)
+  asserteq(bucket, t0)
+  asserteq(seq, 1)
+  asserteq(yottadb.get('tblog', t0, 1), 'a')
+  bucket, seq = log:append_many({'b', 'c'}, t0+20)
+  asserteq(seq, 2)
+  log:append('d', t0+3600)
+  log:append_many({'e', 'f'}, t0+5*3600)
+  asserteq(select(2, log:append_many({}, t0)), nil)
+
+  local function read(...)
+    local values = {}
+    for entry, value, bucket, seq in log:range(...) do
+      asserteq(entry:get(), value)
+      asserteq(entry, yottadb.node('tblog', bucket, seq))
+      table.insert(values, value)
+    end
+    return table.concat(values)
+  end
+  asserteq(read(), 'abcdef')
+  asserteq(read(t0+3600), 'def')
+  asserteq(read(t0+1800, t0+3600), 'abc')  -- reads have the resolution of a bucket
+  asserteq(read(t0+2*3600, t0+5*3600), '')
+  asserteq(read(t0+5*3600+1), 'ef')
+
+  local buckets = {}
+  for bucket in log:buckets() do  table.insert(buckets, bucket)  end
+  asserteq(table.concat(buckets, ','), table.concat({t0, t0+3600, t0+5*3600}, ','))
+
+  asserteq(log:expire(t0+3599), 0)  -- first bucket does not end until t0+3600
+  asserteq(log:expire(t0+3600), 1)
+  asserteq(read(), 'def')
+  asserteq(log:expire(t0+10*3600), 2)
+  asserteq(read(), '')
+
+  -- check expiry relative to the current time
+  log:append('old', os.time() - 4*3600)
+  log:append('new')
+  asserteq(log:expire(), 1)
+  asserteq(read(), 'new')
+  log:kill()
+  assert(not pcall(yottadb.timebuckets, 'tblog', {bucket='week'}))
+  assert(not pcall(yottadb.timebuckets('tblog').expire, yottadb.timebuckets('tblog')))
+end
+
+function test_scan()
+  local n = yottadb.node('scantest')
+  n:kill()
+  for _, sub in ipairs{'a', 'b', 'c', 'd'} do  n(sub):set(sub:upper())  end
+  n('c')('sub'):set('x')
+  n('c'):set(nil)  -- c has a subtree but no value, so is skipped
+  local subs, values, cursor = _yottadb.scan(n, '', 2)
+  asserteq(table.concat(subs, ','), 'a,b')
+  asserteq(table.concat(values, ','), 'A,B')
+  asserteq(cursor, 'b')
+  subs, values, cursor = _yottadb.scan(n, cursor, 2)
+  asserteq(table.concat(subs, ','), 'd')
+  asserteq(table.concat(values, ','), 'D')
+  asserteq(cursor, 'd')
+  subs, values, cursor = _yottadb.scan(n, cursor, 2)
+  asserteq(#subs, 0)
+  asserteq(cursor, nil)
+  subs, values, cursor = _yottadb.scan(n, '', 10, true)
+  asserteq(table.concat(values, ','), 'D,B,A')
+  asserteq(cursor, nil)
+  subs = _yottadb.scan(n, '', 0)
+  asserteq(#subs, 0)
+  n:kill()
+end
+
+function test_stream()
+  local events = yottadb.stream('streamtest')
+  events.node:kill()
+  asserteq(events:last(), 0)
+  asserteq(events:append({'a', 'b', 'c'}), 1)
+  asserteq(events:append('d'), 4)
+  asserteq(events:append({}), nil)
+  asserteq(events:last(), 4)
+  asserteq(yottadb.get('streamtest', '2'), 'b')
+
+  local values, offsets = events:read()
+  asserteq(table.concat(values, ','), 'a,b,c,d')
+  asserteq(table.concat(offsets, ','), '1,2,3,4')
+  values, offsets = events:read(2, 2)
+  asserteq(table.concat(values, ','), 'b,c')
+  asserteq(offsets[1], 2)
+  asserteq(#events:read(5), 0)
+  assert(not pcall(events.read, events, 1.5))
+  assert(not pcall(events.read, events, 0))
+  assert(not pcall(events.read, events, 1, 2.5))
+
+  -- tail with a consumer that saves its offset
+  local consumer = yottadb.node('streamtest_consumer')
+  consumer:kill()
+  local seen = {}
+  for offset, value in events:tail(2, {chunk=2, timeout=0, consumer=consumer}) do
+    table.insert(seen, offset .. value)
+  end
+  asserteq(table.concat(seen, ','), '2b,3c,4d')
+  asserteq(consumer:get(), '5')
+  events:append({'e', 'f'})
+  seen = {}
+  for offset, value in events:tail(nil, {timeout=0, consumer=consumer}) do  table.insert(seen, value)  end
+  asserteq(table.concat(seen), 'ef')
+
+  -- tail without a start offset only returns new entries
+  local follow = events:tail(nil, {poll=0.01, timeout=0.05})
+  asserteq(follow(), nil)
+  events:append('g')
+  asserteq(select(2, follow()), 'g')
+  events.node:kill()
+  consumer:kill()
+end
+
+function test_capture_changes()
+  yottadb.kill('^cdclog')
+  yottadb.kill('^cdc')
+  local captured, class = yottadb.capture_changes('^cdclog')
+  local c = captured('^cdc', 'alice')
+  assert(yottadb.isnode(c))
+  c.email.__ = 'alice@example.com'
+  c('say "hi"'):set('x')
+  asserteq(c.visits:incr(), '1')
+  asserteq(c.visits:incr(2), '3')
+  c.email:kill()
+  c:delete_tree()
+  asserteq(yottadb.get('^cdc', 'alice', 'visits'), nil)
+
+  local changes = yottadb.changes('^cdclog')
+  local expected = {
+    {'set', yottadb.node('^cdc', 'alice', 'email')},
+    {'set', yottadb.node('^cdc', 'alice', 'say "hi"')},
+    {'incr', yottadb.node('^cdc', 'alice', 'visits')},
+    {'incr', yottadb.node('^cdc', 'alice', 'visits')},
+    {'kill', yottadb.node('^cdc', 'alice', 'email')},
+    {'kill', yottadb.node('^cdc', 'alice')},
+  }
+  asserteq(#changes, #expected)
+  for i, change in ipairs(changes) do
+    asserteq(change.seq, i)
+    asserteq(change.op, expected[i][1])
+    asserteq(change.node, expected[i][2])
+  end
+  changes = yottadb.changes('^cdclog', 4, 1)
+  asserteq(#changes, 1)
+  asserteq(changes[1].seq, 5)
+  asserteq(#yottadb.changes(yottadb.stream('^cdclog'), 6), 0)
+
+  -- a failed transaction must record no change
+  local ok = pcall(yottadb.transaction(function()
+    c.x.__ = 'y'
+    error('abort')
+  end))
+  assert(not ok)
+  asserteq(yottadb.get('^cdc', 'alice', 'x'), nil)
+  asserteq(#yottadb.changes('^cdclog', 6), 0)
+  yottadb.kill('^cdclog')
+end
+
+function test_aggregated()
+  yottadb.kill('^agg')
+  yottadb.kill('^aggtotals')
+  local order, class = yottadb.aggregated('^agg', '^aggtotals', {'count', 'sum', 'min', 'max'})
+  local function totals(group)
+    local t = {}
+    for i, kind in ipairs{'count', 'sum', 'min', 'max'} do  t[i] = yottadb.get('^aggtotals', group, kind)  end
+    return table.concat(t, ' ')
+  end
+  order('^agg', 'alice', 1).__ = 30
+  order('^agg', 'alice', 2):set(12)
+  order('^agg', 'bob', 1).__ = 5
+  asserteq(totals('alice'), '2 42 12 30')
+  asserteq(totals('bob'), '1 5 5 5')
+
+  -- overwriting the max value, then killing the min value, rescans the group
+  order('^agg', 'alice', 1).__ = 20
+  asserteq(totals('alice'), '2 32 12 20')
+  order('^agg', 'alice', 2):kill()
+  asserteq(totals('alice'), '1 20 20 20')
+  asserteq(order('^agg', 'alice', 3):incr(4), '4')
+  asserteq(totals('alice'), '2 24 4 20')
+
+  -- killing a subtree removes all its values; an empty group loses its aggregates
+  order('^agg', 'bob', 1, 'x').__ = 7
+  asserteq(totals('bob'), '2 12 5 7')
+  order('^agg', 'bob'):kill()
+  asserteq(yottadb.data('^aggtotals', 'bob'), 0)
+
+  -- aggregates can be recomputed from data written by other means
+  yottadb.set('^agg', 'carol', 1, 9)
+  class.recompute_aggregates()
+  asserteq(totals('alice'), '2 24 4 20')
+  asserteq(totals('carol'), '1 9 9 9')
+
+  -- non-numeric values count as their M numeric prefix
+  order('^agg', 'dave', 1).__ = '12abc'
+  order('^agg', 'dave', 2).__ = 'abc'
+  asserteq(totals('dave'), '2 12 0 12')
+  order('^agg', 'dave', 2):kill()  -- removing the non-numeric min value rescans the group
+  asserteq(totals('dave'), '1 12 12 12')
+  order('^agg', 'dave'):kill()
+
+  -- a failed transaction leaves the aggregates untouched
+  assert(not pcall(yottadb.transaction(function()
+    order('^agg', 'carol', 2).__ = 100
+    error('abort')
+  end)))
+  asserteq(totals('carol'), '1 9 9 9')
+
+  assert(not pcall(function()  order('^other', 1).__ = 1  end))
+  assert(not pcall(function()  order('^agg'):kill()  end))
+  assert(not pcall(yottadb.aggregated, '^agg', '^aggtotals', {'median'}))
+  yottadb.kill('^agg')
+  yottadb.kill('^aggtotals')
+end
+
+function test_probe()
+  yottadb.kill('^probe')
+  local n = yottadb.node('^probe')
+  local data, value, first, last = n:probe()
+  asserteq(data, 0)
+  asserteq(value, nil)
+  asserteq(first, nil)
+  asserteq(last, nil)
+  n.__ = 'root'
+  asserteq(select('#', n:probe()), 4)
+  data, value, first, last = n:probe()
+  asserteq(data, 1)
+  asserteq(value, 'root')
+  asserteq(first, nil)
+  n(2).__ = 'two'
+  n('b', 'x').__ = 'bx'
+  n(-1).__ = 'minus'
+  data, value, first, last = n:probe()
+  asserteq(data, 11)
+  asserteq(value, 'root')
+  asserteq(first, '-1')
+  asserteq(last, 'b')
+  data, value, first, last = n.b:__probe()
+  asserteq(data, 10)
+  asserteq(value, nil)
+  asserteq(first, 'x')
+  asserteq(last, 'x')
+  data, value, first, last = _yottadb.probe('^probe', {'b', 'x'})
+  asserteq(data, 1)
+  asserteq(value, 'bx')
+  asserteq(first, nil)
+  asserteq(last, nil)
+  yottadb.kill('^probe')
+end
+
+function test_compressed()
+  yottadb.kill('^compressed')
+  local json = string.rep('{"name": "value", "items": [1, 2, 3]}, ', 200)
+  asserteq(yottadb.decompress(yottadb.compress(json)), json)
+  assert(#yottadb.compress(json) < #json/10)
+  asserteq(yottadb.compress('short', 10), 'short')
+  asserteq(yottadb.compress('abcdefgh'), 'abcdefgh')  -- incompressible values are stored unchanged
+  asserteq(yottadb.decompress('\254Rraw'), 'raw')
+  asserteq(yottadb.decompress(yottadb.compress('\254Zstarts with marker')), '\254Zstarts with marker')
+  asserteq(yottadb.decompress(yottadb.compress('')), '')
+  asserteq(yottadb.decompress(nil), nil)
+  assert(not pcall(yottadb.decompress, '\254Z\5corrupt'))
+
+  local doc = yottadb.compressed(100)
+  local n = doc('^compressed')
+  n.a.__ = json
+  n.b:set('small value')
+  n.c.__ = 42
+  assert(#yottadb.get('^compressed', 'a') < #json/10)
+  asserteq(yottadb.get('^compressed', 'b'), 'small value')
+  asserteq(n.a.__, json)
+  asserteq(n.a:get(), json)
+  asserteq(n.c:get(), '42')
+  asserteq(n.d:get('default'), 'default')
+  local values = {}
+  for subnode, value, subscript in pairs(n) do  values[subscript] = value  end
+  asserteq(values.a, json)
+  asserteq(values.b, 'small value')
+  n.a.__ = nil
+  asserteq(yottadb.data('^compressed', 'a'), 0)
+  yottadb.kill('^compressed')
+end
+
+function test_dedup()
+  yottadb.kill('^dedup')
+  yottadb.kill('^dedupblobs')
+  asserteq(yottadb.sha256(''), 'e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855')
+  asserteq(yottadb.sha256('abc'), 'ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad')
+
+  local record = yottadb.dedup('^dedupblobs', 10)
+  local template, other = string.rep('template ', 10), string.rep('other ', 10)
+  local hash, other_hash = yottadb.sha256(template), yottadb.sha256(other)
+  local n = record('^dedup')
+  n(1).__ = template
+  n(2):set(template)
+  n(3).__ = 'small'
+  n(4).__ = '\254Hnot a reference'
+  asserteq(yottadb.get('^dedupblobs', hash), template)
+  asserteq(yottadb.get('^dedupblobs', hash, 'refs'), '2')
+  asserteq(yottadb.get('^dedup', 1), '\254H' .. hash)
+  asserteq(n(1).__, template)
+  asserteq(n(2):get(), template)
+  asserteq(n(3):get(), 'small')
+  asserteq(n(4):get(), '\254Hnot a reference')
+  asserteq(n(5):get('default'), 'default')
+  local values = {}
+  for subnode, value, subscript in pairs(n) do  values[tonumber(subscript)] = value  end
+  asserteq(values[1], template)
+  asserteq(values[4], '\254Hnot a reference')
+
+  -- replacing and killing references maintains reference counts and deletes unreferenced blobs
+  n(1).__ = other
+  asserteq(yottadb.get('^dedupblobs', hash, 'refs'), '1')
+  asserteq(yottadb.get('^dedupblobs', other_hash, 'refs'), '1')
+  n(1).__ = other
+  asserteq(yottadb.get('^dedupblobs', other_hash, 'refs'), '1')
+  n(2).__ = nil
+  asserteq(yottadb.data('^dedupblobs', hash), 0)
+  n(6, 'x').__ = other
+  asserteq(yottadb.get('^dedupblobs', other_hash, 'refs'), '2')
+  n:kill()
+  asserteq(yottadb.data('^dedupblobs'), 0)
+  asserteq(yottadb.data('^dedup'), 0)
+
+  -- a reference to a missing blob is an error (use a blob never fetched, since a cached blob remains valid)
+  yottadb.set('^dedup', 1, '\254H' .. yottadb.sha256('never stored'))
+  assert(not pcall(record('^dedup', 1).get, record('^dedup', 1)))
+  yottadb.kill('^dedup')
+end
+
+function test_graph()
+  yottadb.kill('^graph')
+  local edges = {{'a', 'b'}, {'a', 'c'}, {'b', 'd'}, {'c', 'd'}, {'d', 'a'}, {'d', 'e'}, {'e', 'f'}, {'x', 'y'}}
+  for _, edge in ipairs(edges) do  yottadb.set('^graph', edge[1], edge[2], '')  end
+  local g = yottadb.graph('^graph')
+  local vertices, depths = g:bfs('a')
+  asserteq(table.concat(vertices, ','), 'a,b,c,d,e,f')
+  asserteq(table.concat(depths, ','), '0,1,1,2,3,4')
+  vertices, depths = g:bfs('a', {max_depth=2})
+  asserteq(table.concat(vertices, ','), 'a,b,c,d')
+  vertices = g:bfs('a', {limit=3})
+  asserteq(table.concat(vertices, ','), 'a,b,c')
+  vertices = g:bfs('f')
+  asserteq(table.concat(vertices, ','), 'f')
+  asserteq(table.concat(g:neighbors('a'), ','), 'b,c')
+  asserteq(#g:neighbors('f'), 0)
+  asserteq(table.concat(g:neighbors('x'), ','), 'y')
+  asserteq(#g:neighbors('absent'), 0)
+  yottadb.set('^graph', 'e', 'e', '')  -- a self-loop is a neighbor, even though bfs() has already visited it
+  asserteq(table.concat(g:neighbors('e'), ','), 'e,f')
+
+  -- many vertices exercise growth of the visited set
+  for i = 1, 200 do  yottadb.set('^graph', 'hub', i, '')  yottadb.set('^graph', i, 'hub', '')  end
+  vertices, depths = g:bfs('hub')
+  asserteq(#vertices, 201)
+  asserteq(depths[201], 1)
+  assert(not pcall(g.bfs, g, 'a', {max_depth='x'}))
+  yottadb.kill('^graph')
+end
+
+function test_resumable_scan()
+  yottadb.kill('^rscan')
+  yottadb.kill('^rscanstate')
+  yottadb.set('^rscan', 'root')
+  yottadb.set('^rscan', 1, 'a')
+  yottadb.set('^rscan', 1, 'x', 'b')
+  yottadb.set('^rscan', 2, 'c')
+  yottadb.set('^rscan', 3, 'y', 'z', 'd')
+  local checkpoint = yottadb.node('^rscanstate', 'job')
+  local function scan(limit)
+    local seen = {}
+    for subs, value in yottadb.resumable_scan('^rscan', checkpoint, {every=2}) do
+      table.insert(seen, table.concat(subs, '.') .. '=' .. value)
+      if #seen == limit then  break  end
+    end
+    return table.concat(seen, ',')
+  end
+  -- interrupt a scan after 3 nodes: the checkpoint was saved after the 2nd node was processed
+  asserteq(scan(3), '=root,1=a,1.x=b')
+  asserteq(checkpoint:get(), '^rscan("1","x")')
+  asserteq(checkpoint.count:get(), '2')
+  -- resume from the checkpoint, re-scanning the node processed since it was saved
+  asserteq(scan(), '1.x=b,2=c,3.y.z=d')
+  asserteq(checkpoint:data(), 0)
+  asserteq(scan(), '=root,1=a,1.x=b,2=c,3.y.z=d')
+
+  local seen = {}
+  for subs, value in yottadb.resumable_scan(yottadb.node('^rscan', 1), checkpoint) do  table.insert(seen, value)  end
+  asserteq(table.concat(seen, ','), 'a,b')
+  yottadb.kill('^rscan')
+end
+
+function test_node_scan()
+  local n = yottadb.node('^nscan')
+  n:kill()
+  for i = 1, 25 do  n(string.format('%03d', i)):set(i)  end
+  n('005')('sub'):set('x')
+  n('005'):set(nil)  -- has a subtree but no value, so is skipped
+  local function collect(options)
+    local subs, sum = {}, 0
+    for sub, value in n:scan(options) do  table.insert(subs, sub)  sum = sum + value  end
+    return #subs, sum, subs[1]
+  end
+  asserteq(table.concat({collect()}, ' '), '24 320 001')
+  asserteq(table.concat({collect{chunk=7, reverse=true}}, ' '), '24 320 025')
+  asserteq(table.concat({collect{chunk=4, max_tp_restarts=2}}, ' '), '24 320 001')
+  asserteq(table.concat({collect{chunk=4, max_tp_restarts=0, ops_per_sec=1000}}, ' '), '24 320 001')
+  -- 2 YDB calls per child at 500 calls per second must take at least (50-1)/500 seconds
+  local t0 = yottadb.get('$ZUT')
+  asserteq(table.concat({collect{ops_per_sec=500, chunk=10}}, ' '), '24 320 001')
+  assert((tonumber(yottadb.get('$ZUT')) - tonumber(t0))/1e6 >= 49/500 * 0.9)
+  assert(not pcall(n.scan, n, {ops_per_sec='fast'}))
+  assert(not pcall(n.scan, n, {max_tp_restarts=3}))
+  assert(not pcall(function()  for _ in n:scan{ops_per_sec=-1} do end  end))
+  n:kill()
+end
+
+function test_sort()
+  local function list(t)
+    local i = 0
+    return function()  i = i + 1  return t[i]  end
+  end
+  local rows = {'carol,30', 'alice,5', 'bob,200', 'alice,17', 'dave,5'}
+  local amount = function(row)  return tonumber(row:match(',(%d+)$'))  end
+  local sorted = {}
+  for row, key in yottadb.sort(list(rows), {key=amount, scratch='^sorttest'}) do  table.insert(sorted, key .. '=' .. row)  end
+  asserteq(table.concat(sorted, ' '), '5=alice,5 5=dave,5 17=alice,17 30=carol,30 200=bob,200')
+  asserteq(yottadb.node('^sorttest'):data(), 0)  -- scratch is killed on completion
+  sorted = {}
+  for value in yottadb.sort(list{'b', 'c', 10, 'a', 9}) do  table.insert(sorted, value)  end
+  asserteq(table.concat(sorted, ' '), '9 10 a b c')
+  sorted = {}
+  for value, key in yottadb.sort(list{'b', 'c', 'd', 'a'}, {key=function(v)  return ({a=5.0, b=0.5, c=10, d=1e20})[v] or v  end}) do
+    table.insert(sorted, value)
+  end
+  asserteq(table.concat(sorted, ' '), 'b a c d')  -- float keys sort numerically, not as strings like '5.0' or '1e+20'
+
+  local groups = {}
+  local customer = function(row)  return row:match('^[^,]*')  end
+  for name, values in yottadb.sort(list(rows), {key=customer, group=true}) do
+    local total = 0
+    for row in values do  total = total + amount(row)  end
+    table.insert(groups, name .. '=' .. total)
+  end
+  asserteq(table.concat(groups, ' '), 'alice=22 bob=200 carol=30 dave=5')
+  assert(not pcall(yottadb.sort, list{{}}))
+  assert(not pcall(yottadb.sort, list{'x'}, {key=function()  return nil  end}))
+end
+
+function test_temp()
+  local job = yottadb.get('$JOB')
+  local t1, t2 = yottadb.temp('^temptest'), yottadb.temp('^temptest')
+  asserteq(t1:varname(), '^temptest')
+  asserteq(table.concat(t1:subsarray(), ','), job .. ',1')
+  asserteq(table.concat(t2:subsarray(), ','), job .. ',2')
+  asserteq(t1:data(), 0)
+  t1('x'):set('1')
+  t2:set('2')
+  -- nodes of a process that is not running are reclaimed, but not those of running processes like ourselves or init
+  yottadb.set('^temptest', '999999999', '1', 'stale')
+  yottadb.set('^temptest', '1', '1', 'live')
+  asserteq(yottadb.temp_reclaim('^temptest'), 1)
+  asserteq(yottadb.data('^temptest', '999999999'), 0)
+  asserteq(yottadb.get('^temptest', '1', '1'), 'live')
+  asserteq(t1('x'):get(), '1')
+  -- releasing all locks does not make our temp nodes look abandoned
+  yottadb.lock()
+  asserteq(yottadb.temp_reclaim('^temptest'), 0)
+  asserteq(t1('x'):get(), '1')
+  assert(_yottadb.process_alive(tonumber(yottadb.get('$JOB'))))
+  yottadb.kill('^temptest', '1')
+  assert(not pcall(yottadb.temp, 5))
+  yottadb.node('^temptest', job):kill()
+end
+
+function test_rebuild()
+  local target = yottadb.node('^rbtest')
+  target:kill()
+  local reader = yottadb.rebuilt(target)
+  asserteq(reader:node(), nil)
+  assert(not pcall(reader, 'a'))
+  asserteq(yottadb.rebuild(target, function(shadow)  shadow('a'):set('1')  end), 1)
+  asserteq(reader('a'):get(), '1')
+  local version = reader:node()
+  asserteq(reader:node(), version)  -- unchanged generation reuses the cached node
+  asserteq(yottadb.rebuild('^rbtest', function(shadow)  shadow('b'):set('2')  end), 2)
+  asserteq(reader:generation_number(), 2)
+  asserteq(reader('a'):get(), nil)
+  asserteq(reader('b'):get(), '2')
+  asserteq(target('v', 1, 'a'):get(), '1')  -- previous version is kept until the next rebuild
+  -- a failed build is discarded and readers keep the current version; the previous version is dropped
+  local ok, err = pcall(yottadb.rebuild, target, function(shadow)  shadow('c'):set('3')  error('failed', 0)  end)
+  assert(not ok)
+  asserteq(err, 'failed')  -- the builder's error is re-raised unchanged
+  asserteq(reader:generation_number(), 2)
+  asserteq(target('v', 1):data(), 0)
+  asserteq(target('v', 3):data(), 0)
+  asserteq(yottadb.rebuild(target, function(shadow)  shadow('d'):set('4')  end), 4)
+  asserteq(reader('d'):get(), '4')
+  asserteq(target('v', 2, 'b'):get(), '2')
+  target:kill()
+end
+
+function test_bench_generate()
+  local function leaves(varname)
+    local list, subs = {}, {}
+    while true do
+      subs = yottadb.node_next(varname, subs)
+      if not subs then  break  end
+      table.insert(list, table.concat(subs, ',') .. '=' .. yottadb.get(varname, subs))
+    end
+    return list
+  end
+  yottadb.kill('^bgtest1')
+  yottadb.kill('^bgtest2')
+  asserteq(yottadb.bench_generate('^bgtest1', {count=25, depth=2, fanout=10, value_size_dist={min=1, max=20}}), 25)
+  local list = leaves('^bgtest1')
+  asserteq(#list, 25)
+  assert(list[1]:match('^0,0=%l+$'))
+  asserteq(yottadb.data('^bgtest1', {'2', '4'}), 1)
+  asserteq(yottadb.data('^bgtest1', {'2', '5'}), 0)
+  -- the same options generate the same tree; a different seed generates different values
+  yottadb.bench_generate('^bgtest2', {count=25, depth=2, fanout=10, value_size_dist={min=1, max=20}})
+  asserteq(table.concat(leaves('^bgtest2'), ' '), table.concat(list, ' '))
+  yottadb.kill('^bgtest2')
+  yottadb.bench_generate('^bgtest2', {count=25, depth=2, fanout=10, value_size_dist={min=1, max=20}, seed=2})
+  assert(table.concat(leaves('^bgtest2'), ' ') ~= table.concat(list, ' '))
+
+  yottadb.kill('^bgtest2')
+  yottadb.bench_generate('^bgtest2', {count=100, key_kind='str', value_size_dist=5})
+  list = leaves('^bgtest2')
+  asserteq(#list, 100)
+  for _, leaf in ipairs(list) do  assert(leaf:match('^%l%l%l%l%l%l%l=%l%l%l%l%l$'), leaf)  end
+  yottadb.kill('^bgtest2')
+  yottadb.bench_generate('^bgtest2', {count=200, value_size_dist={mean=50, max=400}})
+  for _, leaf in ipairs(leaves('^bgtest2')) do  assert(#leaf:match('=(.*)') <= 400)  end
+  assert(not pcall(yottadb.bench_generate, '^bgtest2', {key_kind='uuid'}))
+  assert(not pcall(yottadb.bench_generate, '^bgtest2', {value_size_dist={min=5}}))
+  assert(not pcall(yottadb.bench_generate, '^bgtest2', {depth=0}))
+  yottadb.kill('^bgtest1')
+  yottadb.kill('^bgtest2')
+end
+
+function test_node_from_glvn()
+  asserteq(yottadb.node_from_glvn('^X("a",1,"b")'), yottadb.node('^X', 'a', '1', 'b'))
+  asserteq(yottadb.node_from_glvn('x'), yottadb.node('x'))
+  asserteq(yottadb.node_from_glvn('%x1(-.5,0,12.25)'), yottadb.node('%x1', '-.5', '0', '12.25'))
+  asserteq(yottadb.node_from_glvn('^X("say ""hi""")'), yottadb.node('^X', 'say "hi"'))
+  asserteq(yottadb.node_from_glvn('^X("a"_$C(0,10)_"b"_$ZCH(255),"")'), yottadb.node('^X', 'a\0\nb\255', ''))
+  asserteq(yottadb.node_from_glvn('^X($c(65),$Char(66))'), yottadb.node('^X', 'A', 'B'))
+  assert(yottadb.isnode(yottadb.node_from_glvn('^X')))
+
+  -- check that ZWRITE output of arbitrary subscripts round-trips
+  local subs = {'abc', 'x"y', '\0\1\127', '-12.5', 'tab\tz'}
+  local node = yottadb.node('^X', subs)
+  local zwr_subs = {}
+  for i, sub in ipairs(subs) do  zwr_subs[i] = yottadb.str2zwr(sub)  end
+  local glvn = '^X(' .. table.concat(zwr_subs, ',') .. ')'
+  asserteq(yottadb.node_from_glvn(glvn), node)
+  node:set('value')
+  asserteq(yottadb.node_from_glvn(glvn):get(), 'value')
+  node:delete_node()
+
+  -- Validate inputs.
+  for _, bad in ipairs{'', '^', '1X', '^X(', '^X()', '^X("a"', '^X("a")junk', '^X(01)', '^X(1.50)', '^X(0.5)',
+      '^X(-0)', '^X("a"_)', '^X($C(1)', '^X($ZCH(256))', '^X(a)', '^X("a" )',
+      '^X(1234567890123456789)'} do  -- too many digits for YDB to collate as a number, so ZWRITE quotes it
+    local ok, e = pcall(yottadb.node_from_glvn, bad)
+    assert(not ok, bad)
+    assert(e:find('Cannot parse glvn'), e)
+  end
+  local ok, e = pcall(yottadb.node_from_glvn, {})
+  assert(not ok)
+  assert(e:find('string expected'))
+end
+
 local inserted_tree = {__='berwyn', [0]='null', [-1]='negative', weight=78, ['!@#$']='junk', appearance={__='handsome', eyes='blue', hair='blond'}, age=yottadb.delete}
 
 local expected_tree_dump = [=[
@@ -11,3 +11,15 @@ concat(cstring,lstring,byref,cout)
 ;empty routine for use by tests/mroutine_benchmarks.lua
 ret()
  quit
+
+;string routines for use by tests/mroutine_benchmarks.lua
+echo(string)
+ quit string
+
+fill(length,out)
+ s out=$J("",length)
+ quit
+
+reverse(io)
+ s io=$RE(io)
+ quit
@@ -2,10 +2,17 @@
 // Copyright 2021-2022, Mitchell; Copyright 2022-2023, Berwyn Hoyt. See LICENSE.
 // @module yottadb.c
 
+#define _POSIX_C_SOURCE 200809L  // for kill()
+
 #include <assert.h>
+#include <errno.h>
+#include <math.h>
 #include <stdint.h> // intptr_t
 #include <stdio.h>
 #include <stdbool.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/types.h>
 
 #include <libyottadb.h>
 #include <lua.h>
@@ -14,6 +21,8 @@
 #include "yottadb.h"
 #include "callins.h"
 #include "cachearray.h"
+#include "compress.h"
+#include "dedup.h"
 
 #ifndef NDEBUG
 #define RECORD_STACK_TOP(l) int orig_stack_top = lua_gettop(l);
@@ -134,6 +143,80 @@ static int get(lua_State *L) {
   return 1;
 }
 
+/// Gets the value of a variable/node, decoding it with `decompress()` if it was stored with `compress()`.
+// Equivalent to `decompress(get(...))` but with only one Lua-to-C transition.
+// @function get_decompressed
+// @usage _yottadb.get_decompressed(varname[, {subs} | ...]),  or:
+// @usage _yottadb.get_decompressed(cachearray)
+// @param varname string
+// @param[opt] subs table of subscripts
+// @param[opt] ... is a list of subscripts
+// @return string or `nil` if node has no data
+static int get_decompressed(lua_State *L) {
+  get(L);
+  lua_replace(L, 1);
+  return lz_decompress(L);
+}
+
+/// Gets the value of a node whose large values are deduplicated into blobs, as stored by `yottadb.dedup()`.
+// If the node's value is a reference to a blob, returns the blob from the C-side cache of hot blobs,
+// or fetches it from `blobs(hash)` and caches it.
+// Raises an error if a referenced blob does not exist.
+// @function dedup_get
+// @usage _yottadb.dedup_get(cachearray, blobs)
+// @param cachearray of the node to get
+// @param blobs cachearray of the node that holds blobs keyed by hash
+// @return string or `nil` if node has no data
+static int dedup_get(lua_State *L) {
+  cachearray_t *blobs = lua_touserdata(L, 2);
+  if (!blobs || !lua_touserdata(L, 1))
+    luaL_error(L, "Parameters #1 and #2 to dedup_get must be cachearray userdata");
+  lua_settop(L, 1);
+  get(L);
+  // STACK: cachearray, value
+  size_t len;
+  const char *value = lua_tolstring(L, 2, &len);
+  if (!value || len < 2 || (unsigned char)value[0] != COMPRESSED_MARKER)
+    return 1;
+  if (value[1] == COMPRESSED_RAW) {
+    lua_pushlstring(L, value+2, len-2);
+    return 1;
+  }
+  if (value[1] != DEDUP_REFERENCE || len != 2+DEDUP_HASH_LEN)
+    return 1;
+  const char *hash = value+2;
+  const char *cached = blob_cache_get(hash, &len);
+  if (cached) {
+    lua_pushlstring(L, cached, len);
+    return 1;
+  }
+
+  int depth = blobs->depth;
+  blobs = blobs->dereference;
+  if (depth >= YDB_MAX_SUBS)
+    luaL_error(L, "Cannot fetch blob: maximum %d subscripts exceeded", YDB_MAX_SUBS);
+  ydb_buffer_t subs[YDB_MAX_SUBS];
+  memcpy(subs, blobs->subs, depth*sizeof(ydb_buffer_t));
+  subs[depth].buf_addr = (char *)hash;
+  subs[depth].len_alloc = subs[depth].len_used = DEDUP_HASH_LEN;
+  ydb_buffer_t blob;
+  YDB_MALLOC_BUFFER_SAFE(&blob, LUA_YDB_BUFSIZ);
+  int status = ydb_get_s(&blobs->varname, depth+1, subs, &blob);
+  if (status == YDB_ERR_INVSTRLEN) {
+    YDB_REALLOC_BUFFER_SAFE(&blob);
+    status = ydb_get_s(&blobs->varname, depth+1, subs, &blob);
+  }
+  if (status == YDB_OK) {
+    blob_cache_put(hash, blob.buf_addr, blob.len_used);
+    lua_pushlstring(L, blob.buf_addr, blob.len_used);
+  }
+  YDB_FREE_BUFFER(&blob);
+  if (status == YDB_ERR_GVUNDEF || status == YDB_ERR_LVUNDEF)
+    luaL_error(L, "Deduplicated blob %s is missing", hash);
+  ydb_assert(L, status);
+  return 1;
+}
+
 /// Deletes a node or tree of nodes.
 // `_yottadb.YDB_DEL_xxxx` are boolean constants and must be supplied as actual boolean
 // (not merely convertable to boolean), so that delete() can distinguish them from subscripts.
@@ -218,6 +301,63 @@ static int data(lua_State *L) {
   return 1;
 }
 
+// Check that the value at stack `index` is a table containing only cachearrays.
+// Raise an error implicating parameter #`index` if not.
+// @return number of cachearrays in the table
+static int check_cachearrays(lua_State *L, int index) {
+  luaL_argcheck(L, lua_istable(L, index), index, "table of {cachearray, cachearray, ...} nodes expected");
+  int num_nodes = luaL_len(L, index);
+  for (int i = 1; i <= num_nodes; i++) {
+    luaL_argcheck(L, lua_geti(L, index, i) == LUA_TUSERDATA, index, "nodes in table must all be cachearrays");
+    lua_pop(L, 1); // pop cachearray
+  }
+  return num_nodes;
+}
+
+/// Returns information about each variable/node in a list, in a single call.
+// Equivalent to calling `data()` on each node, but without a Lua-to-C transition per node.
+// @function data_many
+// @usage _yottadb.data_many({cachearray, cachearray, ...})
+// @param nodes table of cachearrays
+// @return table of `_yottadb.YDB_DATA_xxx` values in the same order as `nodes` (see `data()`)
+static int data_many(lua_State *L) {
+  int num_nodes = check_cachearrays(L, 1);
+  lua_createtable(L, num_nodes, 0);
+  for (int i = 1; i <= num_nodes; i++) {
+    lua_geti(L, 1, i);
+    cachearray_t *array = lua_touserdata(L, -1);
+    int depth = array->depth;
+    lua_pop(L, 1);  // pop cachearray -- it is still referenced by the nodes table
+    array = array->dereference;
+    unsigned int ret_value;
+    ydb_assert(L, ydb_data_s(&array->varname, depth, array->subs, &ret_value));
+    lua_pushinteger(L, ret_value);
+    lua_seti(L, -2, i);
+  }
+  return 1;
+}
+
+/// Deletes each node or tree of nodes in a list, in a single call.
+// Equivalent to calling `delete()` on each node, but without a Lua-to-C transition per node.
+// All nodes are checked to be cachearrays before any are deleted.
+// @function kill_many
+// @usage _yottadb.kill_many({cachearray, cachearray, ...}[, type=_yottadb.YDB_DEL_xxxx])
+// @param nodes table of cachearrays
+// @param[opt] type `_yottadb.YDB_DEL_NODE` or `_yottadb.YDB_DEL_TREE` (see `delete()`)
+static int kill_many(lua_State *L) {
+  int deltype = lua_toboolean(L, 2)? YDB_DEL_TREE: YDB_DEL_NODE;
+  int num_nodes = check_cachearrays(L, 1);
+  for (int i = 1; i <= num_nodes; i++) {
+    lua_geti(L, 1, i);
+    cachearray_t *array = lua_touserdata(L, -1);
+    int depth = array->depth;
+    lua_pop(L, 1);  // pop cachearray -- it is still referenced by the nodes table
+    array = array->dereference;
+    ydb_assert(L, ydb_delete_s(&array->varname, depth, array->subs, deltype));
+  }
+  return 0;
+}
+
 /// Attempts to acquire or increment a lock on a variable/node, waiting as requested.
 // Raises an error if a lock could not be acquired.
 // If no timeout is supplied or is `nil`, wait forever; timeout of zero means try only once.
@@ -375,9 +515,55 @@ static int tp(lua_State *L) {
   return 0;
 }
 
+// Maximum number of digits in an integer subscript that a Lua number can represent exactly
+#if LUA_VERSION_NUM < 503
+  #define MAX_INTEGER_DIGITS 15  /* all Lua numbers are doubles */
+#else
+  #define MAX_INTEGER_DIGITS 18
+#endif
+// Maximum number of significant digits a double can represent exactly
+#define MAX_REAL_DIGITS 15
+
+// Push subscript onto the Lua stack as a Lua number if it is an M canonical number that Lua can represent exactly.
+// Integers are pushed as Lua integers and other numbers as Lua floats.
+// Anything else (including canonical numbers too long for a Lua number) is left for the caller to push as a string.
+// @param subscript buffer containing the subscript
+// @return true if a number was pushed; false if nothing was pushed
+static bool push_number_subscript(lua_State *L, ydb_buffer_t *subscript) {
+  m_number_t number;
+  if (!parse_canonical_number(subscript->buf_addr, subscript->buf_addr + subscript->len_used, &number))
+    return false;
+  if (!number.fraction_len) {
+    if (number.integer_len > MAX_INTEGER_DIGITS) return false;
+    lua_Integer n = 0;
+    for (int i=0; i < number.integer_len; i++)
+      n = n*10 + (number.integer[i] - '0');
+    lua_pushinteger(L, number.negative? -n: n);
+    return true;
+  }
+  if (number.integer_len + number.fraction_len > MAX_REAL_DIGITS) return false;
+  char string[MAX_REAL_DIGITS+3];  // room for sign, decimal point and NUL
+  memcpy(string, subscript->buf_addr, subscript->len_used);
+  string[subscript->len_used] = '\0';
+  return lua_stringtonumber(L, string) != 0;
+}
+
+// Push subscript onto the Lua stack as a string, or as a number if `typed` is true and push_number_subscript() allows it
+static inline void push_subscript(lua_State *L, ydb_buffer_t *subscript, bool typed) {
+  if (!typed || !push_number_subscript(L, subscript))
+    lua_pushlstring(L, subscript->buf_addr, subscript->len_used);
+}
+
+// Return whether a `typed` flag was supplied after a cachearray at stack index 1.
+// The flag is only recognized after a cachearray, since after a varname it would be a subscript.
+static inline bool typed_flag(lua_State *L) {
+  return lua_type(L, 1) == LUA_TUSERDATA && lua_toboolean(L, 2);
+}
+
 typedef int (*subscript_actuator_t) (const ydb_buffer_t *varname, int subs_used, const ydb_buffer_t *subsarray, ydb_buffer_t *ret_value);
 // Underlying function for subscript next or previous
 static int subscript_nexter(lua_State *L, subscript_actuator_t actuator) {
+  bool typed = typed_flag(L);
   int subs_used;
   ydb_buffer_t *varname, *subsarray;
   getsubs(L, subs_used, varname, subsarray);
@@ -389,36 +575,45 @@ static int subscript_nexter(lua_State *L, subscript_actuator_t actuator) {
     YDB_REALLOC_BUFFER_SAFE(&ret_value);
     status = actuator(varname, subs_used, subsarray, &ret_value);
   }
-  if (status == YDB_OK)
+  if (status == YDB_OK) {
+    if (typed)
+      push_subscript(L, &ret_value, true);
     lua_pushlstring(L, ret_value.buf_addr, ret_value.len_used);
+  }
   YDB_FREE_BUFFER(&ret_value);
   if (status == YDB_ERR_NODEEND)
     lua_pushnil(L);
   else
     ydb_assert(L, status);
-  return 1;
+  return typed && status == YDB_OK? 2: 1;
 }
 
 /// Returns the next subscript for a variable/node.
+// If `typed` is true, subscripts that are M canonical numbers are returned as Lua numbers (see `node_next()`),
+// followed by the subscript string, since the string must be used to continue iteration
+// (a Lua float like 0.5 converts back to string "0.5", which is not the M canonical number ".5").
 // @function subscript_next
 // @usage _yottadb.subscript_next(varname[, {subs} | ...]),  or:
-// @usage _yottadb.subscript_next(cachearray)
+// @usage _yottadb.subscript_next(cachearray[, typed])
 // @param varname string
 // @param[opt] subs table of subscripts
 // @param[opt] ... is a list of subscripts
-// @return: string or `nil` if there are no more subscripts
+// @param[opt] typed boolean (only if cachearray is supplied)
+// @return: string or `nil` if there are no more subscripts; if typed: number or string, then string
 static int subscript_next(lua_State *L) {
   return subscript_nexter(L, ydb_subscript_next_s);
 }
 
 /// Returns the previous subscript for a variable/node.
+// If `typed` is true, returns a typed subscript and string as for `subscript_next()`.
 // @function subscript_previous
 // @usage _yottadb.subscript_previous(varname[, {subs} | ...]),  or:
-// @usage _yottadb.subscript_previous(cachearray)
+// @usage _yottadb.subscript_previous(cachearray[, typed])
 // @param varname string
 // @param[opt] subs table of subscripts
 // @param[opt] ... is a list of subscripts
-// @return string or `nil` if there are not any previous subscripts
+// @param[opt] typed boolean (only if cachearray is supplied)
+// @return string or `nil` if there are not any previous subscripts; if typed: number or string, then string
 static int subscript_previous(lua_State *L) {
   return subscript_nexter(L, ydb_subscript_previous_s);
 }
@@ -426,6 +621,7 @@ static int subscript_previous(lua_State *L) {
 typedef int (*node_actuator_t) (const ydb_buffer_t *varname, int subs_used, const ydb_buffer_t *subsarray, int *ret_subs_used, ydb_buffer_t *ret_subsarray);
 // Underlying function for node next or previous
 static int node_nexter(lua_State *L, node_actuator_t actuator) {
+  bool typed = typed_flag(L);
   int subs_used;
   ydb_buffer_t *varname, *subsarray;
   getsubs(L, subs_used, varname, subsarray);
@@ -450,7 +646,7 @@ static int node_nexter(lua_State *L, node_actuator_t actuator) {
   if (status == YDB_OK) {
     lua_createtable(L, ret_subs_used, 0);
     for (int i = 0; i < ret_subs_used; i++) {
-      lua_pushlstring(L, ret_subsarray[i].buf_addr, ret_subsarray[i].len_used);
+      push_subscript(L, &ret_subsarray[i], typed);
       lua_seti(L, -2, i + 1);
     }
   }
@@ -466,11 +662,16 @@ static int node_nexter(lua_State *L, node_actuator_t actuator) {
 
 /// Returns the full subscript table of the next node after a variable/node.
 // A next node chain started from varname will eventually reach all nodes under that varname in order.
+// If `typed` is true, subscripts that are M canonical numbers are returned as Lua numbers, converted in C:
+// integers as Lua integers and others as floats, provided Lua can represent them exactly
+// (up to 18 integer digits or 15 significant digits); all other subscripts are returned as strings.
 // @function node_next
 // @usage _yottadb.node_next(varname[, {subs} | ...])
+// @usage _yottadb.node_next(cachearray[, typed])
 // @param varname string
 // @param[opt] subs table of subscripts
 // @param[opt] ... is a list of subscripts
+// @param[opt] typed boolean (only if cachearray is supplied)
 // @return table of subscripts for the node or `nil` if there are no next nodes
 static int node_next(lua_State *L) {
   return node_nexter(L, ydb_node_next_s);
@@ -478,15 +679,617 @@ static int node_next(lua_State *L) {
 
 /// Returns the full subscript table of the node prior to a variable/node.
 // A previous node chain started from varname will eventually reach all nodes under that varname in reverse order.
+// If `typed` is true, numeric subscripts are returned as Lua numbers as for `node_next()`.
 // @function node_previous
 // @usage _yottadb.node_previous(varname[, {subs}])
+// @usage _yottadb.node_previous(cachearray[, typed])
 // @param varname string
 // @param[opt] subs table of subscripts
+// @param[opt] typed boolean (only if cachearray is supplied)
 // @return table of subscripts for the node or `nil` if there are no previous nodes
 static int node_previous(lua_State *L) {
   return node_nexter(L, ydb_node_previous_s);
 }
 
+// Compare the values of two parsed canonical numbers
+// @return <0, 0, or >0 as for strcmp()
+static int compare_numbers(const m_number_t *a, const m_number_t *b) {
+  if (a->negative != b->negative) return a->negative? -1: 1;
+  int cmp = a->integer_len - b->integer_len;  // canonical integers have no leading zeros, so longer is larger
+  if (!cmp) cmp = memcmp(a->integer, b->integer, a->integer_len);
+  if (!cmp) {
+    int len = a->fraction_len < b->fraction_len? a->fraction_len: b->fraction_len;
+    cmp = memcmp(a->fraction, b->fraction, len);
+    if (!cmp) cmp = a->fraction_len - b->fraction_len;
+  }
+  return a->negative? -cmp: cmp;
+}
+
+// Compare two subscripts as strings in byte order
+// @return <0, 0, or >0 as for strcmp()
+static int compare_strings(const ydb_buffer_t *a, const ydb_buffer_t *b) {
+  unsigned int len = a->len_used < b->len_used? a->len_used: b->len_used;
+  int cmp = memcmp(a->buf_addr, b->buf_addr, len);
+  return cmp? cmp: (int)(a->len_used > b->len_used) - (int)(a->len_used < b->len_used);
+}
+
+// A subscript with its collation information
+typedef struct {
+  ydb_buffer_t subscript;
+  bool is_number;  // whether the subscript collates as a number
+  m_number_t number;  // parsed subscript if is_number
+} collation_key_t;
+
+// Compare subscripts in M collation order (with YDB's default collation):
+// the empty string first, then canonical numbers in numeric order, then strings in byte order.
+// @return <0, 0, or >0 as for strcmp()
+static int compare_keys(const collation_key_t *a, const collation_key_t *b) {
+  if (!a->subscript.len_used || !b->subscript.len_used)
+    return (int)(a->subscript.len_used != 0) - (int)(b->subscript.len_used != 0);
+  if (a->is_number && b->is_number)
+    return compare_numbers(&a->number, &b->number);
+  if (a->is_number != b->is_number)
+    return a->is_number? -1: 1;
+  return compare_strings(&a->subscript, &b->subscript);
+}
+
+// One source of a merged iteration: a node and a cursor subscript at the level below it
+typedef struct {
+  int depth;  // number of subscripts including the cursor subscript
+  collation_key_t key;  // cursor subscript, which points into a Lua string in the keys table
+  ydb_buffer_t varname;
+  ydb_buffer_t subs[YDB_MAX_SUBS];  // subs[depth-1] is the cursor subscript
+} merge_source_t;
+
+typedef struct {
+  bool reverse;
+  int heap_size;  // number of sources in heap, i.e. that have not reached the end
+  int *heap;  // binary min-heap of indexes into sources[], ordered by cursor subscript
+  ydb_buffer_t ret_value;  // scratch buffer for YDB to return subscripts into, allocated as a userdata
+  merge_source_t sources[];
+} merger_t;
+
+// Upvalues of the merge iterator closure. Upvalue 1 is the table of source cachearrays, so they are not garbage collected.
+#define MERGER_UPVALUE lua_upvalueindex(2)
+#define KEYS_UPVALUE lua_upvalueindex(3)  // table of cursor subscript strings, so they are not garbage collected
+#define RET_VALUE_UPVALUE lua_upvalueindex(4)
+
+// Compare the cursors of sources a and b in collation order, reversed if merging in reverse
+static inline int compare_cursors(merger_t *merger, int a, int b) {
+  int cmp = compare_keys(&merger->sources[a].key, &merger->sources[b].key);
+  return merger->reverse? -cmp: cmp;
+}
+
+// Insert source into the heap
+static void heap_push(merger_t *merger, int source) {
+  int *heap = merger->heap;
+  int i = merger->heap_size++;
+  while (i > 0 && compare_cursors(merger, source, heap[(i-1)/2]) < 0) {
+    heap[i] = heap[(i-1)/2];
+    i = (i-1)/2;
+  }
+  heap[i] = source;
+}
+
+// Remove and return the source with the least cursor from the heap
+static int heap_pop(merger_t *merger) {
+  int *heap = merger->heap;
+  int top = heap[0];
+  int last = heap[--merger->heap_size];
+  int i = 0, child;
+  while ((child = 2*i+1) < merger->heap_size) {
+    if (child+1 < merger->heap_size && compare_cursors(merger, heap[child+1], heap[child]) < 0) child++;
+    if (compare_cursors(merger, last, heap[child]) <= 0) break;
+    heap[i] = heap[child];
+    i = child;
+  }
+  heap[i] = last;
+  return top;
+}
+
+// Move the cursor of `source` (0-based) to its next subscript and push it back into the heap unless the end is reached.
+// @param keys_index and ret_value_index are the stack indexes of the keys table and ret_value userdata
+static void merge_advance(lua_State *L, merger_t *merger, int source, int keys_index, int ret_value_index) {
+  merge_source_t *src = &merger->sources[source];
+  subscript_actuator_t actuator = merger->reverse? ydb_subscript_previous_s: ydb_subscript_next_s;
+  int status = actuator(&src->varname, src->depth, src->subs, &merger->ret_value);
+  if (status == YDB_ERR_INVSTRLEN) {
+    // Grow the scratch buffer by replacing its userdata
+    merger->ret_value.len_alloc = merger->ret_value.len_used;
+    merger->ret_value.buf_addr = lua_newuserdata(L, merger->ret_value.len_alloc);
+    lua_replace(L, ret_value_index);
+    status = actuator(&src->varname, src->depth, src->subs, &merger->ret_value);
+  }
+  if (status == YDB_ERR_NODEEND) {
+    lua_pushnil(L);
+    lua_rawseti(L, keys_index, source+1);
+    return;
+  }
+  ydb_assert(L, status);
+  lua_pushlstring(L, merger->ret_value.buf_addr, merger->ret_value.len_used);
+  ydb_buffer_t *cursor = &src->key.subscript;
+  cursor->buf_addr = (char *)lua_tostring(L, -1);
+  cursor->len_alloc = cursor->len_used = merger->ret_value.len_used;
+  src->subs[src->depth-1] = *cursor;
+  src->key.is_number = parse_canonical_number(cursor->buf_addr, cursor->buf_addr + cursor->len_used, &src->key.number);
+  lua_rawseti(L, keys_index, source+1);  // keep the string referenced while the cursor points into it
+  heap_push(merger, source);
+}
+
+// Iterator closure created by merge_iter()
+// @return next subscript in collation order and a table of the (1-based) indexes of the sources that contain it,
+// or nothing when all sources have been exhausted
+static int merge_next(lua_State *L) {
+  merger_t *merger = lua_touserdata(L, MERGER_UPVALUE);
+  if (!merger->heap_size) return 0;
+  int top = merger->heap[0];
+  lua_rawgeti(L, KEYS_UPVALUE, top+1);  // result subscript: stays referenced on the stack after cursors advance
+  collation_key_t key = merger->sources[top].key;
+  lua_newtable(L);
+  int found = 0;
+  do {
+    int source = heap_pop(merger);
+    // Insertion sort the source index into the table, since heap order is not index order
+    int i;
+    for (i = found++; i > 0; i--) {
+      lua_rawgeti(L, -1, i);
+      lua_Integer prev = lua_tointeger(L, -1);
+      lua_pop(L, 1);
+      if (prev < source+1) break;
+      lua_pushinteger(L, prev);
+      lua_rawseti(L, -2, i+1);
+    }
+    lua_pushinteger(L, source+1);
+    lua_rawseti(L, -2, i+1);
+    merge_advance(L, merger, source, KEYS_UPVALUE, RET_VALUE_UPVALUE);
+  } while (merger->heap_size && compare_keys(&merger->sources[merger->heap[0]].key, &key) == 0);
+  return 2;
+}
+
+/// Return an iterator over the child subscripts of several nodes, merged in collation order.
+// Each source node has a cursor, and a heap of cursors yields the least subscript on each iteration.
+// This assumes YDB's default collation: the empty string, then canonical numbers, then strings in byte order.
+// @function merge_iter
+// @usage _yottadb.merge_iter({cachearray, cachearray, ...}[, reverse])
+// @param nodes table of cachearrays
+// @param[opt] reverse boolean to iterate in reverse collation order
+// @return iterator function that returns: subscript, {source_index, ...}
+// where `source_index` is the index in `nodes` of each node that contains subscript, in ascending order
+static int merge_iter(lua_State *L) {
+  bool reverse = lua_toboolean(L, 2);
+  int num_nodes = check_cachearrays(L, 1);
+  // Copy the nodes into a private table so the caller cannot change them during iteration
+  lua_createtable(L, num_nodes, 0);
+  for (int i = 1; i <= num_nodes; i++) {
+    lua_geti(L, 1, i);
+    lua_rawseti(L, -2, i);
+  }
+  lua_replace(L, 1);
+  lua_settop(L, 1);
+  size_t size = sizeof(merger_t) + num_nodes*(sizeof(merge_source_t) + sizeof(int));
+  merger_t *merger = lua_newuserdata(L, size);
+  merger->reverse = reverse;
+  merger->heap_size = 0;
+  merger->heap = (int *)&merger->sources[num_nodes];
+  for (int i = 0; i < num_nodes; i++) {
+    lua_geti(L, 1, i+1);
+    cachearray_t *array = lua_touserdata(L, -1);
+    int depth = array->depth;
+    lua_pop(L, 1);  // pop cachearray -- it stays referenced by the nodes table upvalue
+    array = array->dereference;
+    if (depth >= YDB_MAX_SUBS)
+      luaL_error(L, "Cannot iterate node #%d: maximum %d subscripts exceeded", i+1, YDB_MAX_SUBS);
+    merge_source_t *src = &merger->sources[i];
+    src->depth = depth + 1;
+    src->varname = array->varname;
+    memcpy(src->subs, array->subs, depth*sizeof(ydb_buffer_t));
+    YDB_LITERAL_TO_BUFFER("", &src->subs[depth]);
+  }
+  lua_newtable(L);  // keys table
+  merger->ret_value.len_alloc = LUA_YDB_BUFSIZ;
+  merger->ret_value.buf_addr = lua_newuserdata(L, LUA_YDB_BUFSIZ);
+  // STACK: nodes, merger, keys, ret_value
+  for (int i = 0; i < num_nodes; i++)
+    merge_advance(L, merger, i, 3, 4);
+  lua_pushcclosure(L, merge_next, 4);
+  return 1;
+}
+
+// Fetch into `ret_value` the first (or last, if `actuator` is ydb_subscript_previous_s) child subscript of the node
+// whose subscripts are in `subs`, where `subs` has room for one more subscript after the `depth` used.
+// @return YDB status code
+static int child_bound(subscript_actuator_t actuator, ydb_buffer_t *varname, int depth, ydb_buffer_t *subs, ydb_buffer_t *ret_value) {
+  subs[depth].buf_addr = (char *)"";
+  subs[depth].len_alloc = subs[depth].len_used = 0;
+  int status = actuator(varname, depth+1, subs, ret_value);
+  if (status == YDB_ERR_INVSTRLEN) {
+    YDB_REALLOC_BUFFER_SAFE(ret_value);
+    status = actuator(varname, depth+1, subs, ret_value);
+  }
+  return status;
+}
+
+/// Returns in a single call everything needed to render a node: its data flag, its value, and its first and last child subscripts.
+// Equivalent to calling `data()`, `get()`, and `subscript_next()` and `subscript_previous()` on the node's child with subscript `''`,
+// but with only one Lua-to-C transition and one subscript expansion.
+// The value and child subscripts are only looked up if `data()` shows that they exist.
+// @function probe
+// @usage _yottadb.probe(varname[, {subs} | ...]),  or:
+// @usage _yottadb.probe(cachearray)
+// @param varname string
+// @param[opt] subs table of subscripts
+// @param[opt] ... list of subscripts
+// @return `_yottadb.YDB_DATA_xxx` value as returned by `data()`
+// @return value of the node, or `nil` if it has no value
+// @return subscript string of the first child, or `nil` if it has no children
+// @return subscript string of the last child, or `nil` if it has no children
+static int probe(lua_State *L) {
+  int subs_used;
+  ydb_buffer_t *varname, *subsarray;
+  getsubs(L, subs_used, varname, subsarray);
+
+  unsigned int data;
+  ydb_assert(L, ydb_data_s(varname, subs_used, subsarray, &data));
+  lua_pushinteger(L, data);
+  ydb_buffer_t ret_value;
+  YDB_MALLOC_BUFFER_SAFE(&ret_value, LUA_YDB_BUFSIZ);
+  // The calls below are not atomic with ydb_data_s(), so another process may kill the value or children in between.
+  // Treat them as absent in that case, rather than raising an error.
+  int status = YDB_OK;
+  if (data%2) {
+    status = ydb_get_s(varname, subs_used, subsarray, &ret_value);
+    if (status == YDB_ERR_INVSTRLEN) {
+      YDB_REALLOC_BUFFER_SAFE(&ret_value);
+      status = ydb_get_s(varname, subs_used, subsarray, &ret_value);
+    }
+    if (status == YDB_OK)
+      lua_pushlstring(L, ret_value.buf_addr, ret_value.len_used);
+    else if (status == YDB_ERR_GVUNDEF || status == YDB_ERR_LVUNDEF) {
+      lua_pushnil(L);
+      status = YDB_OK;
+    }
+  } else
+    lua_pushnil(L);
+  if (status == YDB_OK && data >= 10 && subs_used < YDB_MAX_SUBS) {
+    ydb_buffer_t subs[YDB_MAX_SUBS];
+    memcpy(subs, subsarray, subs_used*sizeof(ydb_buffer_t));
+    status = child_bound(ydb_subscript_next_s, varname, subs_used, subs, &ret_value);
+    if (status == YDB_OK) {
+      lua_pushlstring(L, ret_value.buf_addr, ret_value.len_used);
+      status = child_bound(ydb_subscript_previous_s, varname, subs_used, subs, &ret_value);
+      if (status == YDB_OK)
+        lua_pushlstring(L, ret_value.buf_addr, ret_value.len_used);
+      else if (status == YDB_ERR_NODEEND)
+        lua_pop(L, 1);  // children were killed after the first was found
+    }
+    if (status == YDB_ERR_NODEEND) {
+      lua_pushnil(L);
+      lua_pushnil(L);
+      status = YDB_OK;
+    }
+  } else if (status == YDB_OK) {
+    lua_pushnil(L);
+    lua_pushnil(L);
+  }
+  YDB_FREE_BUFFER(&ret_value);
+  ydb_assert(L, status);
+  return 4;
+}
+
+// FNV-1a 32-bit hash of `len` bytes at `s`
+static inline uint32_t fnv1a(const char *s, size_t len) {
+  uint32_t h = 2166136261u;
+  for (size_t i=0; i<len; i++)
+    h = (h ^ (unsigned char)s[i]) * 16777619u;
+  return h;
+}
+
+// Set of visited vertices for bfs(): an open-addressing hash table of strings held in bfs()'s result table
+typedef struct vertex_t {
+  const char *buf;  // NULL if slot is empty
+  size_t len;
+} vertex_t;
+
+typedef struct visited_t {
+  size_t alloc;  // number of slots: always a power of 2
+  size_t used;
+  vertex_t slots[];
+} visited_t;
+
+// Create a visited set with `alloc` slots as a userdata (so that it is freed even if an error occurs) and replace stack `index` with it
+static visited_t *visited_new(lua_State *L, size_t alloc, int index) {
+  visited_t *visited = lua_newuserdata(L, sizeof(visited_t) + alloc*sizeof(vertex_t));
+  memset(visited, 0, sizeof(visited_t) + alloc*sizeof(vertex_t));
+  visited->alloc = alloc;
+  lua_replace(L, index);
+  return visited;
+}
+
+// Find the slot for string `buf` in the visited set: either the slot holding it, or the empty slot where it belongs
+static inline vertex_t *visited_slot(visited_t *visited, const char *buf, size_t len) {
+  size_t mask = visited->alloc-1;
+  for (size_t i = fnv1a(buf, len) & mask; ; i = (i+1) & mask) {
+    vertex_t *slot = &visited->slots[i];
+    if (!slot->buf || (slot->len == len && memcmp(slot->buf, buf, len) == 0))
+      return slot;
+  }
+}
+
+// Add string `buf` to the visited set at stack `index`, growing the set if it becomes more than half full.
+// The string must remain referenced from Lua while it is in the set.
+// @return the visited set, which may have moved
+static visited_t *visited_add(lua_State *L, visited_t *visited, int index, const char *buf, size_t len) {
+  vertex_t *slot = visited_slot(visited, buf, len);
+  slot->buf = buf, slot->len = len;
+  if (++visited->used*2 <= visited->alloc)
+    return visited;
+  visited_t *old = visited;
+  lua_pushvalue(L, index);  // keep the old set referenced while rehashing it
+  visited = visited_new(L, old->alloc*2, index);
+  for (size_t i=0; i<old->alloc; i++) {
+    if (!old->slots[i].buf) continue;
+    *visited_slot(visited, old->slots[i].buf, old->slots[i].len) = old->slots[i];
+  }
+  visited->used = old->used;
+  lua_pop(L, 1);
+  return visited;
+}
+
+/// Returns the vertices of a graph reachable from a start vertex, in breadth-first order, in a single call.
+// The graph is stored as adjacency subscripts: an edge from vertex `v` to vertex `w` is node `graph(v, w)`
+// (which need not have a value). The frontier and the set of visited vertices are kept in C, so vertices are only
+// converted to Lua strings once each, as they are added to the results.
+// @function bfs
+// @usage _yottadb.bfs(cachearray, start[, max_depth[, limit]])
+// @param cachearray of the graph node
+// @param start vertex subscript string
+// @param[opt] max_depth maximum number of edges to follow from the start vertex (default unlimited)
+// @param[opt] limit maximum number of vertices to return, including the start vertex (default unlimited)
+// @return table array of vertex strings in the order visited, starting with the start vertex
+// @return table array of the depth of each of those vertices: the start vertex has depth 0
+static int bfs(lua_State *L) {
+  cachearray_t *array = lua_touserdata(L, 1);
+  if (!array)
+    luaL_error(L, "Parameter #1 to bfs must be a cachearray userdata");
+  luaL_checkstring(L, 2);
+  lua_Integer max_depth = luaL_optinteger(L, 3, -1);
+  lua_Integer limit = luaL_optinteger(L, 4, -1);
+  int depth = array->depth;
+  array = array->dereference;
+  if (depth+2 > YDB_MAX_SUBS)
+    luaL_error(L, "Cannot traverse graph: maximum %d subscripts exceeded", YDB_MAX_SUBS);
+  ydb_buffer_t subs[YDB_MAX_SUBS];
+  memcpy(subs, array->subs, depth*sizeof(ydb_buffer_t));
+  ydb_buffer_t *vertex = &subs[depth], *cursor = &subs[depth+1];
+
+  lua_settop(L, 2);
+  lua_newtable(L);
+  lua_newtable(L);
+  lua_pushnil(L);
+  lua_pushnil(L);
+  // STACK: cachearray, start, vertices, depths, visited, ret_value
+  const int VERTICES=3, DEPTHS=4, VISITED=5, RET_VALUE=6;
+  visited_t *visited = visited_new(L, 64, VISITED);
+  ydb_buffer_t ret_value;
+  ret_value.len_alloc = LUA_YDB_BUFSIZ;
+  ret_value.buf_addr = lua_newuserdata(L, ret_value.len_alloc);
+  lua_replace(L, RET_VALUE);
+
+  size_t len;
+  const char *buf = lua_tolstring(L, 2, &len);
+  lua_pushvalue(L, 2);
+  lua_rawseti(L, VERTICES, 1);
+  lua_pushinteger(L, 0);
+  lua_rawseti(L, DEPTHS, 1);
+  visited = visited_add(L, visited, VISITED, buf, len);
+  lua_Integer found = 1;
+  int status = YDB_OK;
+  // The results tables are the queue: vertex `head` is the next one whose edges to expand
+  for (lua_Integer head = 1; head <= found && (limit < 0 || found < limit); head++) {
+    lua_rawgeti(L, DEPTHS, head);
+    lua_Integer vertex_depth = lua_tointeger(L, -1);
+    lua_rawgeti(L, VERTICES, head);
+    vertex->buf_addr = (char *)lua_tolstring(L, -1, &len);  // stays valid because it is held in the vertices table
+    vertex->len_alloc = vertex->len_used = len;
+    lua_pop(L, 2);
+    if (max_depth >= 0 && vertex_depth >= max_depth) continue;
+    cursor->buf_addr = (char *)"";
+    cursor->len_alloc = cursor->len_used = 0;
+    while (limit < 0 || found < limit) {
+      status = ydb_subscript_next_s(&array->varname, depth+2, subs, &ret_value);
+      if (status == YDB_ERR_INVSTRLEN) {
+        ret_value.len_alloc = ret_value.len_used;
+        ret_value.buf_addr = lua_newuserdata(L, ret_value.len_alloc);
+        lua_replace(L, RET_VALUE);
+        status = ydb_subscript_next_s(&array->varname, depth+2, subs, &ret_value);
+      }
+      if (status != YDB_OK) break;
+      vertex_t *slot = visited_slot(visited, ret_value.buf_addr, ret_value.len_used);
+      if (!slot->buf) {
+        lua_pushlstring(L, ret_value.buf_addr, ret_value.len_used);
+        buf = lua_tolstring(L, -1, &len);  // stays valid because it is held in the vertices table
+        lua_rawseti(L, VERTICES, ++found);
+        lua_pushinteger(L, vertex_depth+1);
+        lua_rawseti(L, DEPTHS, found);
+        visited = visited_add(L, visited, VISITED, buf, len);
+        slot = visited_slot(visited, buf, len);
+      }
+      // continue from the visited copy of the subscript because ret_value is overwritten by the next call
+      cursor->buf_addr = (char *)slot->buf;
+      cursor->len_alloc = cursor->len_used = slot->len;
+    }
+    if (status != YDB_OK && status != YDB_ERR_NODEEND) break;
+    status = YDB_OK;
+  }
+  ydb_assert(L, status);
+  lua_settop(L, DEPTHS);
+  return 2;
+}
+
+// A call that takes PACE_SLOW_FACTOR times longer than the fastest call seen (and at least PACE_SLOW_MIN seconds)
+// indicates contention for the database, e.g. waiting for critical sections, locks or disk, so the rate is halved.
+// Each call that is not slow then recovers the rate by PACE_RECOVERY towards the target rate.
+#define PACE_SLOW_FACTOR 8
+#define PACE_SLOW_MIN 0.001
+#define PACE_RECOVERY 1.02
+#define PACE_MIN_RATE 1.0
+
+// State of a scan paced to a maximum number of YDB calls per second, kept in a Lua table between calls to scan()
+typedef struct pacer_t {
+  lua_Number target, rate;  // target and current maximum number of calls per second
+  lua_Number fastest;  // duration of the fastest call seen, in seconds, or 0 if none yet
+  lua_Number next;  // time in seconds before which the next call may not start
+} pacer_t;
+
+// Return the current time in seconds
+static lua_Number pace_now(void) {
+  struct timespec t;
+  timespec_get(&t, TIME_UTC);
+  return t.tv_sec + t.tv_nsec/1e9;
+}
+
+// Read pacer state from table fields ops_per_sec, rate, fastest and next of the table at stack index `index`
+static void pacer_read(lua_State *L, int index, pacer_t *pacer) {
+  lua_getfield(L, index, "ops_per_sec");
+  pacer->target = lua_tonumber(L, -1);
+  if (pacer->target <= 0)
+    luaL_error(L, "Pacing field ops_per_sec must be a positive number");
+  lua_getfield(L, index, "rate");
+  pacer->rate = lua_isnil(L, -1)? pacer->target: lua_tonumber(L, -1);
+  lua_getfield(L, index, "fastest");
+  pacer->fastest = lua_tonumber(L, -1);
+  lua_getfield(L, index, "next");
+  pacer->next = lua_tonumber(L, -1);
+  lua_pop(L, 4);
+}
+
+// Write pacer state back to the table at stack index `index`
+static void pacer_write(lua_State *L, int index, pacer_t *pacer) {
+  lua_pushnumber(L, pacer->rate);
+  lua_setfield(L, index, "rate");
+  lua_pushnumber(L, pacer->fastest);
+  lua_setfield(L, index, "fastest");
+  lua_pushnumber(L, pacer->next);
+  lua_setfield(L, index, "next");
+}
+
+// Sleep until the next YDB call is allowed to start. Set *started to the time it starts.
+// Return YDB_OK or the error status of the sleep.
+static int pace_wait(pacer_t *pacer, lua_Number *started) {
+  lua_Number now = pace_now();
+  if (now < pacer->next) {
+    int status = ydb_hiber_start((unsigned long long)((pacer->next - now) * 1e9));
+    if (status != YDB_OK) return status;
+    now = pace_now();
+  }
+  *started = now;
+  return YDB_OK;
+}
+
+// Account for a YDB call that started at time `started`: back off if it was slow, and schedule the next call
+static void pace_done(pacer_t *pacer, lua_Number started) {
+  lua_Number elapsed = pace_now() - started;
+  if (pacer->fastest <= 0 || elapsed < pacer->fastest)
+    pacer->fastest = elapsed;
+  if (elapsed > PACE_SLOW_FACTOR*pacer->fastest && elapsed > PACE_SLOW_MIN)
+    pacer->rate = pacer->rate/2 > PACE_MIN_RATE? pacer->rate/2: PACE_MIN_RATE;
+  else
+    pacer->rate = pacer->rate*PACE_RECOVERY < pacer->target? pacer->rate*PACE_RECOVERY: pacer->target;
+  pacer->next = started + 1/pacer->rate;
+}
+
+/// Returns the subscripts and values of up to `max` children of a node, in collation order, in a single call.
+// Scanning starts at the first child after subscript `after` (use `''` to start from the first child).
+// Children without a value (those with only a subtree) are skipped but count towards `max`.
+// Continue the scan by calling `scan()` again with `after` set to the returned `cursor`.
+// If a `pacing` table is supplied, every `ydb_subscript_next_s()` and `ydb_get_s()` call is paced to start no more
+// often than `pacing.rate` times per second. The rate is halved whenever a call is much slower than the fastest call
+// seen, which indicates contention with other processes, and recovers gradually towards `pacing.ops_per_sec`.
+// The pacing state is stored back into fields `rate`, `fastest` and `next` of the table to continue pacing in the next call.
+// @function scan
+// @usage _yottadb.scan(cachearray, after, max[, reverse[, pacing]])
+// @param cachearray of the node whose children to scan
+// @param after subscript string after which to start scanning
+// @param max maximum number of children to scan
+// @param[opt] reverse boolean to scan in reverse collation order
+// @param[opt] pacing table with field `ops_per_sec`, the maximum number of YDB calls per second
+// @return table array of subscripts
+// @return table array of values for those subscripts
+// @return cursor: subscript of the last child scanned, or `nil` if the scan reached the last child
+static int scan(lua_State *L) {
+  cachearray_t *array = lua_touserdata(L, 1);
+  if (!array)
+    luaL_error(L, "Parameter #1 to scan must be a cachearray userdata");
+  size_t after_len;
+  const char *after = luaL_checklstring(L, 2, &after_len);
+  lua_Integer max = luaL_checkinteger(L, 3);
+  luaL_argcheck(L, max >= 0, 3, "max must not be negative");
+  subscript_actuator_t actuator = lua_toboolean(L, 4)? ydb_subscript_previous_s: ydb_subscript_next_s;
+  pacer_t pace, *pacer = NULL;
+  if (!lua_isnoneornil(L, 5)) {
+    luaL_checktype(L, 5, LUA_TTABLE);
+    pacer_read(L, 5, &pace);
+    pacer = &pace;
+  }
+  int depth = array->depth;
+  array = array->dereference;
+  if (depth >= YDB_MAX_SUBS)
+    luaL_error(L, "Cannot scan node: maximum %d subscripts exceeded", YDB_MAX_SUBS);
+  ydb_buffer_t subs[YDB_MAX_SUBS];
+  memcpy(subs, array->subs, depth*sizeof(ydb_buffer_t));
+  ydb_buffer_t *cursor = &subs[depth];
+  cursor->buf_addr = (char *)after;
+  cursor->len_alloc = cursor->len_used = after_len;
+
+  lua_settop(L, 5);  // keep `after` at stack index 2 as the cursor string, to keep it referenced
+  lua_createtable(L, max < 64? max: 64, 0);
+  lua_createtable(L, max < 64? max: 64, 0);
+  // STACK: cachearray, cursor_string, max, reverse, pacing, subscripts, values
+  ydb_buffer_t subscript, value;
+  YDB_MALLOC_BUFFER_SAFE(&subscript, LUA_YDB_BUFSIZ);
+  YDB_MALLOC_BUFFER_SAFE(&value, LUA_YDB_BUFSIZ);
+  int status = YDB_OK, found = 0;
+  lua_Number started = 0;
+  for (lua_Integer n = 0; n < max; n++) {
+    if (pacer && (status = pace_wait(pacer, &started)) != YDB_OK) break;
+    status = actuator(&array->varname, depth+1, subs, &subscript);
+    if (status == YDB_ERR_INVSTRLEN) {
+      YDB_REALLOC_BUFFER_SAFE(&subscript);
+      status = actuator(&array->varname, depth+1, subs, &subscript);
+    }
+    if (pacer) pace_done(pacer, started);
+    if (status != YDB_OK) break;
+    lua_pushlstring(L, subscript.buf_addr, subscript.len_used);
+    cursor->buf_addr = (char *)lua_tostring(L, -1);
+    cursor->len_alloc = cursor->len_used = subscript.len_used;
+    lua_replace(L, 2);  // the cursor now points into this string, so keep it referenced
+    if (pacer && (status = pace_wait(pacer, &started)) != YDB_OK) break;
+    status = ydb_get_s(&array->varname, depth+1, subs, &value);
+    if (status == YDB_ERR_INVSTRLEN) {
+      YDB_REALLOC_BUFFER_SAFE(&value);
+      status = ydb_get_s(&array->varname, depth+1, subs, &value);
+    }
+    if (pacer) pace_done(pacer, started);
+    if (status == YDB_ERR_GVUNDEF || status == YDB_ERR_LVUNDEF) continue;
+    if (status != YDB_OK) break;
+    found++;
+    lua_pushvalue(L, 2);
+    lua_rawseti(L, 6, found);
+    lua_pushlstring(L, value.buf_addr, value.len_used);
+    lua_rawseti(L, 7, found);
+  }
+  YDB_FREE_BUFFER(&subscript);
+  YDB_FREE_BUFFER(&value);
+  if (pacer) pacer_write(L, 5, pacer);
+  if (status == YDB_ERR_NODEEND) {
+    lua_pushnil(L);
+    lua_replace(L, 2);
+  } else
+    ydb_assert(L, status);
+  lua_pushvalue(L, 2);
+  return 3;
+}
+
 /// Releases all locks held and attempts to acquire all requested locks, waiting as requested.
 // Raises an error if a lock could not be acquired.
 // If no timeout is supplied or is `nil`, wait forever; timeout of zero means try only once.
@@ -598,50 +1401,311 @@ static int incr(lua_State *L) {
   return 1;
 }
 
-/// Returns the zwrite-formatted version of the given string.
-// @function str2zwr
-// @usage _yottadb.str2zwr(s)
-// @param s string
-// @return zwrite-formatted string
-static int str2zwr(lua_State *L) {
+// Fast path for the common case: push the zwrite-formatted version of printable-ASCII string `s` without calling YDB.
+// @return false if `s` contains other characters (or the result would be too long), leaving YDB to handle it
+static bool fast_str2zwr(lua_State *L, const char *s, size_t len) {
+  size_t quotes = 0;
+  for (size_t i=0; i<len; i++) {
+    unsigned char c = s[i];
+    if (c < ' ' || c > '~') return false;
+    quotes += c == '"';
+  }
+  size_t size = len + quotes + 2;
+  if (size > YDB_MAX_STR) return false;
+  luaL_Buffer b;
+  char *out = luaL_buffinitsize(L, &b, size);
+  *out++ = '"';
+  for (size_t i=0; i<len; i++) {
+    if (s[i] == '"') *out++ = '"';  // double any embedded quotes
+    *out++ = s[i];
+  }
+  *out = '"';
+  luaL_pushresultsize(&b, size);
+  return true;
+}
+
+// Fast path for the common case: push the string described by zwrite-formatted `s` without calling YDB,
+// provided `s` is a single quoted string of printable ASCII.
+// @return false if `s` is in any other form, leaving YDB to handle it
+static bool fast_zwr2str(lua_State *L, const char *s, size_t len) {
+  if (len < 2 || s[0] != '"' || s[len-1] != '"') return false;
+  size_t quotes = 0;
+  for (size_t i=1; i<len-1; i++) {
+    unsigned char c = s[i];
+    if (c < ' ' || c > '~') return false;
+    if (c == '"') {
+      if (i+1 >= len-1 || s[i+1] != '"') return false;  // closing quote before the end, e.g. "a"_$C(0)
+      i++, quotes++;
+    }
+  }
+  size_t size = len - 2 - quotes;
+  luaL_Buffer b;
+  char *out = luaL_buffinitsize(L, &b, size);
+  for (size_t i=1; i<len-1; i++) {
+    *out++ = s[i];
+    if (s[i] == '"') i++;  // skip the doubled quote
+  }
+  luaL_pushresultsize(&b, size);
+  return true;
+}
+
+// Push the zwrite-formatted version of string `s`, calling YDB only if necessary.
+// @param zwr is a buffer for YDB's output: it is allocated on first use and may be reused (and grown) across calls;
+// the caller must free it if it is allocated
+// @return YDB status code
+static int push_str2zwr(lua_State *L, const char *s, size_t len, ydb_buffer_t *zwr) {
+  if (fast_str2zwr(L, s, len)) return YDB_OK;
   ydb_buffer_t str;
-  YDB_STRING_TO_BUFFER(luaL_checkstring(L, 1), &str);
-  str.len_alloc = str.len_used = luaL_len(L, 1); // in case of NUL bytes
+  str.buf_addr = (char *)s;
+  str.len_alloc = str.len_used = len;
+  if (!zwr->buf_addr) YDB_MALLOC_BUFFER_SAFE(zwr, LUA_YDB_BUFSIZ);
+  int status = ydb_str2zwr_s(&str, zwr);
+  if (status == YDB_ERR_INVSTRLEN) {
+    YDB_REALLOC_BUFFER_SAFE(zwr);
+    status = ydb_str2zwr_s(&str, zwr);
+  }
+  if (status == YDB_OK)
+    lua_pushlstring(L, zwr->buf_addr, zwr->len_used);
+  return status;
+}
+
+// Push the string described by zwrite-formatted string `s`, calling YDB only if necessary.
+// @param str is a buffer for YDB's output, used as for `push_str2zwr()`
+// @return YDB status code
+static int push_zwr2str(lua_State *L, const char *s, size_t len, ydb_buffer_t *str) {
+  if (fast_zwr2str(L, s, len)) return YDB_OK;
   ydb_buffer_t zwr;
-  YDB_MALLOC_BUFFER_SAFE(&zwr, LUA_YDB_BUFSIZ);
-  int status = ydb_str2zwr_s(&str, &zwr);
+  zwr.buf_addr = (char *)s;
+  zwr.len_alloc = zwr.len_used = len;
+  if (!str->buf_addr) YDB_MALLOC_BUFFER_SAFE(str, LUA_YDB_BUFSIZ);
+  int status = ydb_zwr2str_s(&zwr, str);
   if (status == YDB_ERR_INVSTRLEN) {
-    YDB_REALLOC_BUFFER_SAFE(&zwr);
-    status = ydb_str2zwr_s(&str, &zwr);
+    YDB_REALLOC_BUFFER_SAFE(str);
+    status = ydb_zwr2str_s(&zwr, str);
   }
-  if (status == YDB_OK) {
-    lua_pushlstring(L, zwr.buf_addr, zwr.len_used);
+  if (status == YDB_OK)
+    lua_pushlstring(L, str->buf_addr, str->len_used);
+  return status;
+}
+
+typedef int (*zwr_converter)(lua_State *L, const char *s, size_t len, ydb_buffer_t *buf);
+
+// Apply `convert` to the string at stack index 1 and push the result
+static int convert_one(lua_State *L, zwr_converter convert) {
+  size_t len;
+  const char *s = luaL_checklstring(L, 1, &len);
+  ydb_buffer_t buf = {0, 0, NULL};
+  int status = convert(L, s, len, &buf);
+  if (buf.buf_addr) YDB_FREE_BUFFER(&buf);
+  ydb_assert(L, status);
+  return 1;
+}
+
+// Apply `convert` to each string in the table at stack index 1 and push a table of the results.
+// A single output buffer is shared by all conversions that need YDB.
+static int convert_many(lua_State *L, zwr_converter convert) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+  int n = luaL_len(L, 1);
+  lua_createtable(L, n, 0);
+  ydb_buffer_t buf = {0, 0, NULL};
+  int status = YDB_OK;
+  for (int i=1; i<=n && status==YDB_OK; i++) {
+    lua_geti(L, 1, i);
+    size_t len;
+    const char *s = lua_tolstring(L, -1, &len);
+    if (!s) {
+      if (buf.buf_addr) YDB_FREE_BUFFER(&buf);
+      return luaL_error(L, "string expected at index %d of table (got %s)", i, luaL_typename(L, -1));
+    }
+    status = convert(L, s, len, &buf);
+    if (status == YDB_OK)
+      lua_seti(L, -3, i);
+    lua_pop(L, 1);  // pop string
   }
-  YDB_FREE_BUFFER(&zwr);
+  if (buf.buf_addr) YDB_FREE_BUFFER(&buf);
   ydb_assert(L, status);
   return 1;
 }
 
+/// Returns the zwrite-formatted version of the given string.
+// Printable ASCII strings are converted natively; only other strings call YDB.
+// @function str2zwr
+// @usage _yottadb.str2zwr(s)
+// @param s string
+// @return zwrite-formatted string
+static int str2zwr(lua_State *L) {
+  return convert_one(L, push_str2zwr);
+}
+
 /// Returns the string described by the given zwrite-formatted string.
+// Single quoted strings of printable ASCII are converted natively; only other strings call YDB.
 // @function zwr2str
 // @usage _yottadb.zwr2str(s)
 // @param s zwrite-formatted string
 // @return string
 static int zwr2str(lua_State *L) {
-  ydb_buffer_t zwr;
-  YDB_STRING_TO_BUFFER(luaL_checkstring(L, 1), &zwr);
-  ydb_buffer_t str;
-  YDB_MALLOC_BUFFER_SAFE(&str, LUA_YDB_BUFSIZ);
-  int status = ydb_zwr2str_s(&zwr, &str);
-  if (status == YDB_ERR_INVSTRLEN) {
-    YDB_REALLOC_BUFFER_SAFE(&str);
-    status = ydb_zwr2str_s(&zwr, &str);
+  return convert_one(L, push_zwr2str);
+}
+
+/// Returns a table of the zwrite-formatted versions of every string in the given table.
+// This is faster than calling `str2zwr()` for each string.
+// @function str2zwr_many
+// @usage _yottadb.str2zwr_many({s1, s2, ...})
+// @param strings table of strings
+// @return table of zwrite-formatted strings
+static int str2zwr_many(lua_State *L) {
+  return convert_many(L, push_str2zwr);
+}
+
+/// Returns a table of the strings described by every zwrite-formatted string in the given table.
+// This is faster than calling `zwr2str()` for each string.
+// @function zwr2str_many
+// @usage _yottadb.zwr2str_many({zwr1, zwr2, ...})
+// @param zwrs table of zwrite-formatted strings
+// @return table of strings
+static int zwr2str_many(lua_State *L) {
+  return convert_many(L, push_zwr2str);
+}
+
+
+/// Sleeps for the given number of seconds, without interfering with YottaDB's use of timers and signals.
+// @function sleep
+// @usage _yottadb.sleep(seconds)
+// @param seconds number of seconds to sleep (may be fractional)
+static int sleep_seconds(lua_State *L) {
+  lua_Number seconds = luaL_checknumber(L, 1);
+  if (seconds > 0)
+    ydb_assert(L, ydb_hiber_start((unsigned long long)(seconds * 1e9)));
+  return 0;
+}
+
+/// Returns whether a process with the given process id is running, like M's `$ZGETJPI(pid,"ISPROCALIVE")`.
+// A process that exists but belongs to another user counts as running.
+// @function process_alive
+// @usage _yottadb.process_alive(pid)
+// @param pid integer process id, e.g. the `$JOB` of a YDB process
+// @return boolean
+static int process_alive(lua_State *L) {
+  lua_Integer pid = luaL_checkinteger(L, 1);
+  luaL_argcheck(L, pid > 0 && pid == (pid_t)pid, 1, "process id must be a positive integer");
+  lua_pushboolean(L, kill((pid_t)pid, 0) == 0 || errno == EPERM);
+  return 1;
+}
+
+/// Returns a stable 32-bit hash of the given string, e.g. to choose a partition for a key.
+// Uses the FNV-1a algorithm, so the result is the same on every platform, process and Lua version.
+// @function hash
+// @usage _yottadb.hash(s)
+// @param s string
+// @return integer hash from 0 to 2^32-1
+static int hash(lua_State *L) {
+  size_t len;
+  const char *s = luaL_checklstring(L, 1, &len);
+  lua_pushinteger(L, fnv1a(s, len));
+  return 1;
+}
+
+// Return the next pseudo-random number in the splitmix64 sequence with the given state
+static uint64_t splitmix64(uint64_t *state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+// Write into `buf` the subscript for child number `n` at tree level `level`, and return its length.
+// Integer keys are just `n`. String keys are 7 lowercase letters encoding a bijective scramble of `n` within each level,
+// so they are unique among siblings but do not collate in the order of `n`.
+static int generated_key(char *buf, uint64_t n, int level, uint64_t seed, bool string_keys) {
+  if (!string_keys)
+    return sprintf(buf, "%llu", (unsigned long long)n);
+  uint32_t x = ((uint32_t)n ^ (uint32_t)(seed + level*0x9E3779B9u)) * 0x2C1B3C6Du;  // odd multiplier is bijective mod 2^32
+  for (int i = 6; i >= 0; i--) {
+    buf[i] = 'a' + x % 26;
+    x /= 26;
   }
-  if (status == YDB_OK) {
-    lua_pushlstring(L, str.buf_addr, str.len_used);
+  return 7;
+}
+
+/// Populates a node with a synthetic tree of nodes, deterministically from a seed, for use by benchmarks.
+// Sets `count` leaf nodes at `depth` levels of subscripts below the node. Each level below the first has up to `fanout`
+// children per parent and the first level has as many as it takes to hold `count` leaves. Only leaves have values.
+// Value sizes are uniformly distributed between `min_size` and `max_size`, or if `mean_size` is given, exponentially
+// distributed with that mean and clamped to that range. Values are strings of pseudo-random lowercase letters.
+// The same arguments always produce the same tree.
+// @function generate
+// @usage _yottadb.generate(cachearray, count, depth, fanout, string_keys, seed, min_size, max_size[, mean_size])
+// @param cachearray of the node to populate
+// @param count number of leaf nodes to set
+// @param depth number of subscript levels below the node
+// @param fanout maximum number of children of each parent below the first level
+// @param string_keys boolean: true for subscripts of 7 letters, or false for integer subscripts
+// @param seed integer to seed the pseudo-random number generator
+// @param min_size minimum value size in bytes
+// @param max_size maximum value size in bytes
+// @param[opt] mean_size mean value size in bytes for an exponential distribution of sizes
+// @return number of nodes set
+static int generate(lua_State *L) {
+  cachearray_t *array = lua_touserdata(L, 1);
+  if (!array)
+    luaL_error(L, "Parameter #1 to generate must be a cachearray userdata");
+  lua_Integer count = luaL_checkinteger(L, 2);
+  int levels = luaL_checkinteger(L, 3);
+  lua_Integer fanout = luaL_checkinteger(L, 4);
+  bool string_keys = lua_toboolean(L, 5);
+  uint64_t seed = (uint64_t)luaL_checkinteger(L, 6);
+  lua_Integer min_size = luaL_checkinteger(L, 7);
+  lua_Integer max_size = luaL_checkinteger(L, 8);
+  lua_Number mean_size = luaL_optnumber(L, 9, 0);
+  luaL_argcheck(L, count >= 0, 2, "count must not be negative");
+  luaL_argcheck(L, fanout >= 1 && fanout <= UINT32_MAX, 4, "fanout must be from 1 to 2^32-1");
+  luaL_argcheck(L, min_size >= 0 && min_size <= max_size, 7, "min_size must be from 0 to max_size");
+  luaL_argcheck(L, max_size <= YDB_MAX_STR, 8, "max_size exceeds the maximum YDB string length");
+  int depth = array->depth;
+  array = array->dereference;
+  luaL_argcheck(L, levels >= 1 && depth+levels <= YDB_MAX_SUBS, 3, "depth must be at least 1 and within maximum subscripts");
+
+  ydb_buffer_t subs[YDB_MAX_SUBS];
+  char keys[YDB_MAX_SUBS][24];
+  memcpy(subs, array->subs, depth*sizeof(ydb_buffer_t));
+  for (int level = 0; level < levels; level++)
+    subs[depth+level].buf_addr = keys[level];
+  ydb_buffer_t value;
+  YDB_MALLOC_BUFFER_SAFE(&value, max_size > 0? max_size: 1);
+  uint64_t state = seed;
+  int status = YDB_OK;
+  lua_Integer n;
+  for (n = 0; n < count; n++) {
+    // Leaf n has subscripts of n's digits in base `fanout`, with the first level taking all the higher digits
+    uint64_t rest = n;
+    for (int level = levels-1; level >= 0; level--) {
+      uint64_t digit = level? rest % fanout: rest;
+      rest /= fanout;
+      int len = generated_key(keys[level], digit, level, seed, string_keys);
+      subs[depth+level].len_alloc = subs[depth+level].len_used = len;
+    }
+    uint64_t random = splitmix64(&state);
+    lua_Integer size = min_size;
+    if (max_size > min_size) {
+      if (mean_size > 0) {
+        double uniform = ((random >> 11) + 1) * (1.0/9007199254740992.0);  // (0, 1] from 53 random bits
+        double sized = -mean_size * log(uniform);
+        size = sized < min_size? min_size: sized > max_size? max_size: (lua_Integer)sized;
+      } else
+        size = min_size + random % (uint64_t)(max_size-min_size+1);
+    }
+    for (lua_Integer i = 0; i < size; i += 8) {
+      uint64_t letters = splitmix64(&state);
+      for (int j = 0; j < 8 && i+j < size; j++, letters >>= 8)
+        value.buf_addr[i+j] = 'a' + (letters & 0xFF) % 26;
+    }
+    value.len_used = size;
+    status = ydb_set_s(&array->varname, depth+levels, subs, &value);
+    if (status != YDB_OK) break;
   }
-  YDB_FREE_BUFFER(&str);
+  YDB_FREE_BUFFER(&value);
   ydb_assert(L, status);
+  lua_pushinteger(L, n);
   return 1;
 }
 
@@ -654,9 +1718,14 @@ static int zwr2str(lua_State *L) {
 
 static const luaL_Reg yottadb_functions[] = {
   {"get", get},
+  {"get_decompressed", get_decompressed},
+  {"dedup_get", dedup_get},
   {"set", set},
   {"delete", delete},
   {"data", data},
+  {"probe", probe},
+  {"data_many", data_many},
+  {"kill_many", kill_many},
   {"lock_incr", lock_incr},
   {"lock_decr", lock_decr},
   {"tp", tp},
@@ -664,11 +1733,23 @@ static const luaL_Reg yottadb_functions[] = {
   {"subscript_previous", subscript_previous},
   {"node_next", node_next},
   {"node_previous", node_previous},
+  {"merge_iter", merge_iter},
+  {"scan", scan},
+  {"bfs", bfs},
   {"lock", lock},
   {"delete_excl", delete_excl},
   {"incr", incr},
   {"str2zwr", str2zwr},
   {"zwr2str", zwr2str},
+  {"str2zwr_many", str2zwr_many},
+  {"zwr2str_many", zwr2str_many},
+  {"hash", hash},
+  {"generate", generate},
+  {"compress", lz_compress},
+  {"decompress", lz_decompress},
+  {"sha256", sha256},
+  {"sleep", sleep_seconds},
+  {"process_alive", process_alive},
   {"message", message},
   {"ci_tab_open", ci_tab_open},
   {"cip", cip},
@@ -677,6 +1758,7 @@ static const luaL_Reg yottadb_functions[] = {
   {"init", init},
   {"ydb_eintr_handler", _ydb_eintr_handler},
   {"cachearray_create", cachearray_create},
+  {"cachearray_fromglvn", cachearray_fromglvn},
   {"cachearray_setmetatable", cachearray_setmetatable},
   {"cachearray_tomutable", cachearray_tomutable},
   {"cachearray_subst", cachearray_subst},
@@ -72,6 +72,7 @@ M.ydb_eintr_handler = _yottadb.ydb_eintr_handler
 -- Valid type tables which may be passed to assert_type() below
 local _number_boolean = {number=true, boolean=true}
 local _number_nil = {number=true, ['nil']=true}
+local _string_nil = {string=true, ['nil']=true}
 local _string_number = {string=true, number=true}
 local _string_number_nil = {string=true, number=true, ['nil']=true}
 local _table_nil = {table=true, ['nil']=true}
@@ -168,6 +169,31 @@ local function q_number(str)
   return num and tostring(num)==str and num or nil
 end
 
+--- Convert number `n` to a string in M canonical form, e.g. `0.5` to `'.5'`, `5.0` to `'5'` and `1e20` to `'100000000000000000000'`.
+-- Unlike `tostring()`, this gives subscripts that YDB collates as numbers.
+-- Non-integers are rounded to the 15 significant digits that a double can represent exactly.
+-- @param n number
+-- @return string
+local function canonical_number(n)
+  if n ~= n or n == math.huge or n == -math.huge then
+    error(string.format("%s cannot be converted to an M canonical number", n), 2)
+  end
+  if (math.type and math.type(n) == 'integer') or (n == math.floor(n) and math.abs(n) < 2^53) then
+    return string.format('%d', n)
+  end
+  local sign, digits, exponent = string.format('%.14e', n):match('^(-?)(%d%.%d+)e([-+]%d+)$')
+  digits = digits:gsub('%.', ''):gsub('0+$', '')
+  local point = tonumber(exponent) + 1  -- number of digits before the decimal point
+  if point <= 0 then
+    digits = '.' .. string.rep('0', -point) .. digits
+  elseif point >= #digits then
+    digits = digits .. string.rep('0', point-#digits)
+  else
+    digits = digits:sub(1, point) .. '.' .. digits:sub(point+1)
+  end
+  return sign .. digits
+end
+
 --- Get the YDB error code (if any) contained in the given error message.
 -- @param message String error message.
 -- @return the YDB error code (if any) for the given error message,
@@ -180,6 +206,27 @@ function M.get_error_code(message)
   return tonumber(assert_type(message, 'string', 1):match('YDB Error: (%-?%d+):'))
 end
 
+--- Convert a table of node specifiers into a table of cachearrays for passing to `_yottadb` list functions.
+-- Each element may be a node object or a table `{varname[, subsarray]}`.
+-- If all elements are already nodes, the original table is returned without copying it.
+-- @param nodes Table array of node specifiers
+-- @param narg Argument number of `nodes` to report in error messages
+-- @return table of cachearrays
+local function cachearray_list(nodes, narg)
+  local list = nodes
+  for i, v in ipairs(nodes) do
+    if type(v) ~= 'userdata' then
+      if type(v) ~= 'table' then
+        error(string.format("bad argument #%s to '%s' (node or table expected at index %s, got %s)", narg, debug.getinfo(2, 'n').name or '?', i, type(v)), 3)
+      end
+      if list == nodes then  list = {table.unpack(nodes, 1, i-1)}  end
+      v = _yottadb.cachearray_create(table.unpack(v))
+    end
+    if list ~= nodes then  list[i] = v  end
+  end
+  return list
+end
+
 -- Class metatable for an object that represents a YDB node.
 local node = {}
 
@@ -207,6 +254,20 @@ local key = {}
 -- -- 11.0
 M.data = _yottadb.data
 
+--- Return whether each node in a list has a value or subtree, using a single call into YottaDB.
+-- This is faster than calling `data()` on each node since it avoids the Lua-to-C overhead per node.
+-- @param nodes Table array of node objects or `{varname[, subsarray]}` tables
+-- @return Table array of `data()` results, in the same order as `nodes`
+-- @see data
+-- @example
+-- -- include setup from example at yottadb.set()
+-- ydb.data_many({ydb.node('^Population', 'USA'), {'^Population', {'France'}}})
+-- -- {11, 0}
+function M.data_many(nodes)
+  assert_type(nodes, 'table', 1)
+  return _yottadb.data_many(cachearray_list(nodes, 1))
+end
+
 --- Deprecated and replaced by `set(varname[, subsarray[, ...]], nil)`.
 -- @function delete_node
 -- @invocation yottadb.delete_node('varname'[, {subsarray}][, ...])
@@ -254,6 +315,20 @@ end
 --- @deprecated v3.0
 M.delete_tree = M.kill
 
+--- Deletes the database tree (node and subnodes) of each node in a list, using a single call into YottaDB.
+-- This is faster than calling `kill()` on each node since it avoids the Lua-to-C overhead per node.
+-- @param nodes Table array of node objects or `{varname[, subsarray]}` tables
+-- @see kill
+-- @example
+-- -- include setup from example at yottadb.set()
+-- ydb.kill_many({ydb.node('^Population', 'USA'), {'^Population', {'Belgium'}}})
+-- ydb.data('^Population', {'USA'})
+-- -- 0
+function M.kill_many(nodes)
+  assert_type(nodes, 'table', 1)
+  _yottadb.kill_many(cachearray_list(nodes, 1), true)
+end
+
 --- Gets and returns the value of a database variable or node; or `nil` if the variable or node does not exist.
 -- @function get
 -- @invocation yottadb.get('varname'[, {subsarray}][, ...])
@@ -393,13 +468,23 @@ M.release = M.lock_decr
 --- Returns the full subscript list of the next node after a database variable or node.
 -- A next node chain started from varname will eventually reach all nodes under that varname in order.
 --
+-- If a cachearray (node) is supplied, it may be followed by the `typed` flag. In that case, subscripts that are
+-- M canonical numbers are returned as Lua numbers (converted in C), as long as Lua can represent them exactly:
+-- integers of up to 18 digits as Lua integers, and other numbers of up to 15 significant digits as floats.
+-- All other subscripts remain strings.
+--
+-- *Caution:* a typed float subscript like `.5` becomes Lua number `0.5`, which converts back to the string subscript
+-- `"0.5"` rather than the numeric subscript `.5`. So do not use typed float subscripts to create nodes.
+-- Integer subscripts do not have this problem.
+--
 -- *Note:* `node:gettree()` or `node:subscripts()` may be a better way to iterate a node tree
 -- @function node_next
 -- @invocation yottadb.node_next('varname'[, {subsarray}][, ...])
--- @invocation yottadb.node_next(cachearray)
+-- @invocation yottadb.node_next(cachearray[, typed])
 -- @param varname String of the database node (this can also be replaced by cachearray)
 -- @param[opt] subsarray Table of subscripts
 -- @param[opt] ... List of subscripts to append after any elements in optional subsarray table
+-- @param[opt] typed Boolean flag to return numeric subscripts as Lua numbers (only after a cachearray)
 -- @return list of subscripts for the node, or `nil` if there isn't a next node
 -- @example
 -- -- include setup from example at yottadb.set()
@@ -430,12 +515,14 @@ M.node_next = _yottadb.node_next
 -- A previous node chain started from varname will eventually reach all nodes under that varname in reverse order.
 --
 -- *Note:* `node:gettree()` or `node:subscripts()` may be a better way to iterate a node tree
+-- The `typed` flag works as for `node_next()`.
 -- @function node_previous
 -- @invocation yottadb.node_previous('varname'[, {subsarray}][, ...])
--- @invocation yottadb.node_previous(cachearray)
+-- @invocation yottadb.node_previous(cachearray[, typed])
 -- @param varname String of the database node (this can also be replaced by cachearray)
 -- @param[opt] subsarray Table of subscripts
 -- @param[opt] ... List of subscripts to append after any elements in optional subsarray table
+-- @param[opt] typed Boolean flag to return numeric subscripts as Lua numbers (only after a cachearray)
 -- @return list of subscripts for the node, or `nil` if there isn't a previous node
 -- @example
 -- -- include setup from example at yottadb.set()
@@ -548,6 +635,32 @@ function M.subscripts(varname, ...)
   return iterator, nil, ''  -- iterate using child from ''
 end
 
+--- Returns an iterator over the child subscripts of several nodes, merged into a single sequence in collation order.
+-- Each subscript is returned once, along with a list of which nodes contain it.
+-- This is useful to query across globals partitioned by time or region, without collecting all subscripts
+-- into Lua and sorting them. The merge uses a heap of cursors in C.
+--
+-- *Caution:* the merge assumes YottaDB's default collation sequence: empty string, then canonical numbers
+-- in numeric order, then strings in byte order. Do not use it on globals that use an alternative collation sequence.
+-- @param nodes Table array of node objects or `{varname[, subsarray]}` tables
+-- @param[opt] reverse boolean to iterate in reverse collation order
+-- @return iterator for use in a for loop that returns: subscript, sources
+-- where `sources` is an ascending list of the indexes in `nodes` of the nodes that contain `subscript`
+-- @example
+-- ydb = require('yottadb')
+-- ydb.set('^Log2023', 'alice', 1)  ydb.set('^Log2023', 'bob', 1)
+-- ydb.set('^Log2024', 'bob', 1)  ydb.set('^Log2024', 'carol', 1)
+-- for subscript, sources in ydb.merge_iter({ydb.node('^Log2023'), ydb.node('^Log2024')}) do
+--   print(subscript, table.concat(sources, ','))
+-- end
+-- -- alice  1
+-- -- bob    1,2
+-- -- carol  2
+function M.merge_iter(nodes, reverse)
+  assert_type(nodes, 'table', 1)
+  return _yottadb.merge_iter(cachearray_list(nodes, 1), reverse)
+end
+
 --- Returns the zwrite-formatted version of the given string.
 -- @function str2zwr
 -- @param s String to format.
@@ -578,6 +691,25 @@ M.str2zwr = _yottadb.str2zwr
 -- -- true
 M.zwr2str = _yottadb.zwr2str
 
+--- Returns a table of the zwrite-formatted versions of every string in the given table.
+-- This is faster than calling `str2zwr()` on each string. Printable ASCII strings are formatted without calling YottaDB.
+-- @function str2zwr_many
+-- @param strings table of strings
+-- @return table of formatted strings
+-- @example
+-- ydb=require('yottadb')
+-- ydb.str2zwr_many({'abc', 'say "hi"', 'X\0'})
+-- -- {'"abc"', '"say ""hi"""', '"X"_$C(0)'}
+M.str2zwr_many = _yottadb.str2zwr_many
+
+--- Returns a table of the strings described by every zwrite-formatted string in the given table.
+-- This is faster than calling `zwr2str()` on each string.
+-- @function zwr2str_many
+-- @param zwrs table of strings in zwrite format
+-- @return table of strings
+-- @see str2zwr_many
+M.zwr2str_many = _yottadb.zwr2str_many
+
 -- The following 6 lines defines the 'High level functions' section to appear
 -- before 'Transactions' in the docs. The blank lines in between are necessary:
 
@@ -966,6 +1098,24 @@ function M.node(varname, ...)
   return self
 end
 
+--- Creates a node object from an M glvn (global or local variable name) string such as those output by `ZWRITE`.
+-- The string is parsed directly into the node in C, which is faster than building it from Lua strings.
+-- Subscripts may be canonical numbers or quoted strings with embedded quotes doubled,
+-- concatenated using `_` with `$C()` or `$ZCH()` character lists.
+-- In UTF-8 mode (env `ydb_chset=UTF-8`), `$C(n)` specifies a Unicode code point; otherwise it specifies a byte like `$ZCH(n)`.
+-- Raises an error if the string is not a valid glvn.
+-- @param glvn string name of variable, e.g. `'^X("a",1,"b")'`
+-- @return node object with metatable `yottadb.node`
+-- @example
+-- ydb = require 'yottadb'
+-- ydb.node_from_glvn('^X("a",1,"say ""hi"""_$C(0))')
+-- -- ^X("a",1,"say ""hi"""_$C(0))
+-- ydb.node_from_glvn('^X("a",1,"b")') == ydb.node('^X', 'a', 1, 'b')
+-- -- true
+function M.node_from_glvn(glvn)
+  return _yottadb.cachearray_setmetatable(_yottadb.cachearray_fromglvn(glvn), node)
+end
+
 --- Tests whether object is a node object or inherits from a node object.
 -- @param object to test
 -- @return boolean true or false
@@ -1060,16 +1210,27 @@ node.release = node.lock_decr
 -- Very slightly faster than node:__pairs() because it iterates subscript names without fetching the node value. <br>
 -- Note that `subscripts()` order is guaranteed to equal the M collation sequence.
 -- @param[opt] reverse set to true to iterate in reverse order
+-- @param[opt] typed set to true to yield subscripts that are M canonical numbers as Lua numbers (see `node_next()`)
 -- @example
 -- ydb = require 'yottadb'
 -- node = ydb.node('^myvar', 'subs1')
 -- for subscript in node:subscripts() do  print subscript  end
+-- @example
+-- -- sum integer-keyed orders ^ORD(12345) without calling tonumber() on each key
+-- for id in ydb.node('^ORD'):subscripts(false, true) do  total = total + id  end
 -- @return iterator over *child* subscript names of a node, which returns a sequence of subscript name strings
 -- @see node:__pairs
-function node:subscripts(reverse)
+function node:subscripts(reverse, typed)
   local actuator = reverse and _yottadb.subscript_previous or _yottadb.subscript_next
   local subnode = _yottadb.cachearray_append(self, '')
   subnode = _yottadb.cachearray_tomutable(subnode)
+  if typed then
+    return function()
+      local subscript, str = actuator(subnode, true)
+      subnode = _yottadb.cachearray_subst(subnode, str or '')
+      return subscript
+    end, nil, ''
+  end
   local function iterator()
     local subscript = actuator(subnode)
     subnode = _yottadb.cachearray_subst(subnode, subscript or '')
@@ -1078,6 +1239,82 @@ function node:subscripts(reverse)
   return iterator, nil, ''  -- iterate using child from ''
 end
 
+--- Return iterator over the *child* subscripts and values of a node, rate-limited so as not to starve other processes.
+-- This is intended for background maintenance jobs that share the database with latency-sensitive traffic.
+-- Children are fetched in chunks by `_yottadb.scan()`, which paces its YDB calls in C to at most `ops_per_sec` calls
+-- per second, counting each `ydb_subscript_next_s()` and each `ydb_get_s()` as one call.
+-- The rate automatically backs off when YDB calls take much longer than usual, as happens when other processes
+-- hold critical sections or locks, and recovers gradually once they are fast again. <br>
+-- If `max_tp_restarts` is given, each chunk is read in a transaction, which gives each chunk a consistent view.
+-- Transactions are not paced within, since sleeping inside a transaction makes restarts more likely and, on its final
+-- retry, holds the database critical section. Instead, after each transaction the scan sleeps for the time that its
+-- YDB calls were budgeted at `ops_per_sec`. If a transaction restarts more than `max_tp_restarts` times, it is rolled
+-- back and retried after a pause with a halved rate and chunk size, so that the scan yields to the updates that
+-- conflict with it. `max_tp_restarts` may be at most 2, so that the scan never reaches YDB's final retry, which
+-- holds the critical section for the whole transaction. <br>
+-- Children without a value (those with only a subtree) are skipped.
+-- @param[opt] options table of options:
+--
+--   * `ops_per_sec`: maximum number of YDB calls per second, or `nil` to scan without pacing
+--   * `max_tp_restarts`: maximum restarts (0 to 2) of each chunk's transaction before backing off, or `nil` for no transaction
+--   * `chunk`: maximum number of children fetched per call into C (default 100)
+--   * `reverse`: set to true to scan in reverse collation order
+-- @example
+-- for sub, value in ydb.node('^ORD'):scan{ops_per_sec=2000, max_tp_restarts=2} do  audit(sub, value)  end
+-- @return iterator over the child subscripts and values of a node, which returns `subscript, value` pairs
+-- @see node:subscripts
+function node:scan(options)
+  options = options or {}
+  assert_type(options, 'table', 1, ":scan")
+  assert_type(options.ops_per_sec, _number_nil, 1, ":scan")
+  assert_type(options.max_tp_restarts, _number_nil, 1, ":scan")
+  assert_type(options.chunk, _number_nil, 1, ":scan")
+  local chunk = options.chunk or 100
+  local pacing = options.ops_per_sec and {ops_per_sec=options.ops_per_sec}
+  local reverse, max_restarts = options.reverse, options.max_tp_restarts
+  if max_restarts and (max_restarts < 0 or max_restarts > 2) then
+    error("max_tp_restarts must be from 0 to 2 to avoid YDB's final retry, which holds the critical section", 2)
+  end
+  local subs, values, cursor, i = {}, {}, '', 0
+  local delay = 0.001  -- seconds to pause after a rollback, doubled after each consecutive rollback
+  local read_chunk = max_restarts and M.transaction(function(result)
+    if tonumber(M.get('$TRESTART')) > max_restarts then  M.trollback()  end
+    result[1], result[2], result[3] = _yottadb.scan(self, cursor, chunk, reverse)  -- never pace inside a transaction
+  end)
+
+  return function()
+    i = i + 1
+    while not subs[i] and cursor do
+      if read_chunk then
+        local result = {}
+        local ok, err = pcall(read_chunk, result)
+        if ok then
+          subs, values, cursor = result[1], result[2], result[3]
+          delay = 0.001
+          if pacing then
+            -- sleep for the chunk's budget of one subscript_next and one get per child, then recover the rate
+            local rate = pacing.rate or pacing.ops_per_sec
+            _yottadb.sleep(2*chunk / rate)
+            pacing.rate = math.min(rate*1.25, pacing.ops_per_sec)
+          end
+        elseif M.get_error_code(err) == _yottadb.YDB_TP_ROLLBACK then
+          if pacing then  pacing.rate = math.max((pacing.rate or pacing.ops_per_sec)/2, 1)  end
+          chunk = math.max(math.floor(chunk/2), 1)
+          _yottadb.sleep(delay)
+          delay = math.min(delay*2, 1)
+          subs = {}
+        else
+          error(err, 2)
+        end
+      else
+        subs, values, cursor = _yottadb.scan(self, cursor, chunk, reverse, pacing)
+      end
+      i = 1
+    end
+    return subs[i], values[i]
+  end
+end
+
 -- Constant that may be passed to `node:settree()`
 -- declare a unique flag value yottadb.DELETE to pass to settree to instruct deletion of a value
 -- @see node:settree
@@ -1227,14 +1464,23 @@ end
 --   fetching the node value.
 -- @function node:__pairs
 -- @param[opt] reverse Boolean flag iterates in reverse if true
+-- @param[opt] typed Boolean flag yields subscripts that are M canonical numbers as Lua numbers if true (see `node_next()`)
 -- @example for subnode,value[,subscript] in pairs(node) do  subnode:incr(value)  end
 -- -- to double the values of all subnodes of node
 -- @return 3 values: `subnode_object`, `subnode_value_or_nil`, `subscript`
 -- @see node:subscripts
-function node:__pairs(reverse)
+function node:__pairs(reverse, typed)
   local actuator = reverse and _yottadb.subscript_previous or _yottadb.subscript_next
   local subnode = _yottadb.cachearray_append(self, '')
   subnode = _yottadb.cachearray_tomutable(subnode)
+  if typed then
+    return function()
+      local subscript, str = actuator(subnode, true)
+      subnode = _yottadb.cachearray_subst(subnode, str or '')
+      if subscript==nil then return  nil  end
+      return subnode, _yottadb.get(subnode), subscript
+    end, nil, ''
+  end
   local function iterator()
     local subscript = actuator(subnode)
     subnode = _yottadb.cachearray_subst(subnode, subscript or '')
@@ -1457,6 +1703,14 @@ node.depth = _yottadb.cachearray_depth
 --   `yottadb.YDB_DATA_VALUE_DESC` (value and subtree)
 -- @function node:data
 node.data = _yottadb.data
+--- Fetch, in a single call, the node's 'data' bitfield, its value, and its first and last child subscripts.
+-- This is faster than calling `data()`, `get()` and iterating children separately, e.g. to render a tree.
+-- @return 'data' bitfield as returned by `node:data()`
+-- @return value of the node, or `nil` if it has no value
+-- @return subscript string of the first child, or `nil` if it has no children
+-- @return subscript string of the last child, or `nil` if it has no children
+-- @function node:probe
+node.probe = _yottadb.probe
 --- Return true if the node has a value; otherwise false.
 function node:has_value()  return node.data(self)%2 == 1  end
 --- Return true if the node has a tree; otherwise false.
@@ -1470,6 +1724,1209 @@ function node:subsarray()
   return subsarray
 end
 
+-- ~~~ Data structures built from nodes ~~~
+
+--- Partitioned nodes
+-- @section
+
+-- Class metatable for a variable partitioned across several database variables
+local partitioned = {}
+partitioned.__index = partitioned
+
+--- Create an object that spreads the top-level keys of one logical variable across several database variables (partitions).
+-- Each key is routed to a partition by a stable hash of the key, so a key always lives in the same partition.
+-- Map the partitions to different database regions to spread I/O, journaling and B-tree size across database files.
+-- Calling the object with a key returns an ordinary node in the key's partition, so existing code that takes nodes
+-- can use it unchanged. Operations over all keys (`pairs()`, `count()`, `sum()`, `reduce()`) gather results from every partition.
+--
+-- *Caution:* changing the number or order of partitions changes which partition each key lives in.
+-- @param partitions table array of variable names or nodes, one per partition
+-- @return partitioned object
+-- @example
+-- ydb = require('yottadb')
+-- users = ydb.partitioned({'^Users1', '^Users2', '^Users3'})
+-- users('alice').age.__ = 30  -- sets one of: ^Users1("alice","age")=30 ^Users2(...) or ^Users3(...)
+-- users('bob').age.__ = 40
+-- users:count()
+-- -- 2
+-- users:sum('age')
+-- -- 70
+-- for user, value, name in pairs(users) do  print(name, user.age.__)  end
+-- -- alice  30
+-- -- bob    40
+function M.partitioned(partitions)
+  assert_type(partitions, 'table', 1)
+  assert(#partitions > 0, "partitioned() requires at least one partition")
+  local self = setmetatable({partitions={}}, partitioned)
+  for i, partition in ipairs(partitions) do
+    self.partitions[i] = M.isnode(partition) and partition or M.node(partition)
+  end
+  return self
+end
+
+--- Return the index of the partition that holds `key`.
+-- Number keys are hashed in M canonical form, so that keys M treats as the same subscript (e.g. `1`, `1.0` and `'1'`)
+-- are always in the same partition.
+-- @param key string or number
+-- @return integer index into the partitions table supplied to `partitioned()`
+function partitioned:partition(key)
+  if type(key) == 'number' then  key = canonical_number(key)  end
+  return _yottadb.hash(key) % #self.partitions + 1
+end
+
+--- Return the node of top-level `key` in its partition, further subscripted by any subsequent subscripts.
+-- @param key string or number
+-- @param[opt] ... list of further subscripts
+-- @return node
+-- @usage partitioned_object(key[, ...])
+function partitioned:__call(key, ...)
+  assert_type(key, _string_number, 1)
+  if type(key) == 'number' then  key = canonical_number(key)  end
+  return self.partitions[self:partition(key)](key, ...)
+end
+
+--- Iterate all top-level keys across all partitions, in collation order.
+-- Yields the same values as `pairs(node)` on an unpartitioned node.
+-- @param[opt] reverse set to true to iterate in reverse order
+-- @return iterator that returns: subnode, value, key
+-- @see merge_iter
+function partitioned:__pairs(reverse)
+  local partitions = self.partitions
+  local merged = M.merge_iter(partitions, reverse)
+  return function()
+    local key, sources = merged()
+    if key == nil then  return nil  end
+    local subnode = partitions[sources[1]](key)
+    return subnode, _yottadb.get(subnode), key
+  end, nil, ''
+end
+partitioned.pairs = partitioned.__pairs
+
+--- Return the number of top-level keys across all partitions.
+function partitioned:count()
+  local count = 0
+  for _, partition in ipairs(self.partitions) do
+    for _ in partition:__subscripts() do  count = count + 1  end
+  end
+  return count
+end
+
+--- Call `func(accumulator, subnode, key)` for every top-level key across all partitions, and return the final accumulator.
+-- Partitions are visited one after another, so keys are not visited in collation order.
+-- @param func function(accumulator, subnode, key) returning the new accumulator
+-- @param[opt] initial value of the accumulator
+-- @return accumulator returned by the final call to `func` (or `initial` if there are no keys)
+function partitioned:reduce(func, initial)
+  assert_type(func, 'function', 1)
+  local accumulator = initial
+  for _, partition in ipairs(self.partitions) do
+    for key in partition:__subscripts() do
+      accumulator = func(accumulator, partition(key), key)
+    end
+  end
+  return accumulator
+end
+
+--- Return the sum of the numeric values of every top-level key across all partitions.
+-- Nodes without a value are skipped.
+-- @param[opt] ... subscripts of the value under each key to sum instead of the key's own value
+-- @return number
+-- @example users:sum('age')  -- sums ^UsersN(key,"age") over all keys
+function partitioned:sum(...)
+  local n = select('#', ...)
+  local subs = {...}
+  return self:reduce(function(total, subnode)
+    local value = _yottadb.get(n > 0 and subnode(table.unpack(subs, 1, n)) or subnode)
+    return value and total + (tonumber(value) or 0) or total
+  end, 0)
+end
+
+--- Delete all keys in all partitions.
+function partitioned:kill()
+  for _, partition in ipairs(self.partitions) do  partition:kill()  end
+end
+
+--- @section end
+
+--- Time-bucketed logs
+-- @section
+
+-- Class metatable for a log of entries grouped into time buckets
+local timebuckets = {}
+timebuckets.__index = timebuckets
+
+local bucket_sizes = {minute=60, hour=3600, day=86400}
+
+--- Create an object that stores a log of entries in time buckets under a node, so that old entries expire cheaply.
+-- Each entry is stored at `node(bucket, seq)`, where `bucket` is the bucket's start time in seconds since the epoch
+-- and `seq` numbers the entries within each bucket in order of appending. The last `seq` used is stored at `node(bucket)`.
+-- Expiring old entries kills whole buckets, each with a single delete, rather than deleting entries one by one.
+-- @param node node object or variable name under which to store the buckets
+-- @param[opt] options table of options:
+--
+-- * `bucket`: bucket size in seconds, or `'minute'`, `'hour'` or `'day'` (default `'hour'`). Buckets are aligned to the epoch (UTC).
+-- * `retain`: number of seconds of entries to keep when calling `expire()` without a time
+-- @return timebuckets object
+-- @example
+-- ydb = require('yottadb')
+-- log = ydb.timebuckets('^Log', {bucket='hour', retain=7*86400})
+-- log:append('user logged in')  -- stores ^Log(1700000000,1)="user logged in" (bucket times vary)
+-- log:append_many({'event 1', 'event 2'})
+-- for entry, value, bucket, seq in log:range(os.time()-3600) do  print(bucket, seq, value)  end
+-- log:expire()  -- kill buckets older than 7 days
+function M.timebuckets(node, options)
+  assert_type(options, _table_nil, 2)
+  options = options or {}
+  local size = bucket_sizes[options.bucket or 'hour'] or options.bucket
+  assert(type(size)=='number' and size >= 1 and size%1 == 0, "timebuckets() option 'bucket' must be a whole number of seconds, 'minute', 'hour' or 'day'")
+  assert_type(options.retain, _number_nil, 2)
+  return setmetatable({node=M.isnode(node) and node or M.node(node), size=size, retain=options.retain}, timebuckets)
+end
+
+--- Return the start time of the bucket that contains `time`.
+-- @param[opt] time seconds since the epoch (default `os.time()`)
+-- @return integer seconds since the epoch
+function timebuckets:bucket(time)
+  time = time or os.time()
+  return math.floor(time / self.size) * self.size
+end
+
+--- Append `value` to the bucket for `time`.
+-- @param value to store
+-- @param[opt] time seconds since the epoch (default `os.time()`)
+-- @return bucket start time
+-- @return seq of the new entry within its bucket
+function timebuckets:append(value, time)
+  local bucket = self:bucket(time)
+  local bucket_node = self.node(bucket)
+  local seq = bucket_node:incr()
+  bucket_node(seq):set(value)
+  return bucket, tonumber(seq)
+end
+
+--- Append every value in table `values` to the bucket for `time`, using a single increment for the whole batch.
+-- @param values table array of values to store
+-- @param[opt] time seconds since the epoch (default `os.time()`)
+-- @return bucket start time
+-- @return seq of the first new entry within its bucket
+function timebuckets:append_many(values, time)
+  assert_type(values, 'table', 1)
+  local bucket = self:bucket(time)
+  local bucket_node = self.node(bucket)
+  local n = #values
+  if n == 0 then  return bucket, nil  end
+  local first = tonumber(bucket_node:incr(n)) - n + 1
+  for i = 1, n do
+    bucket_node(first+i-1):set(values[i])
+  end
+  return bucket, first
+end
+
+--- Iterate the start times of all buckets that contain entries, in time order.
+-- @return iterator that returns bucket start times as numbers
+function timebuckets:buckets()
+  return self.node:subscripts(false, true)
+end
+
+--- Iterate entries in buckets that overlap the period from `from` up to (but not including) `to`, in time order.
+-- Reads have the resolution of a bucket: all entries in each overlapping bucket are returned.
+-- @param[opt] from start time in seconds since the epoch (default: the first bucket)
+-- @param[opt] to end time in seconds since the epoch (default: after the last bucket)
+-- @return iterator that returns: entry node, value, bucket start time, seq
+function timebuckets:range(from, to)
+  assert_type(from, _number_nil, 1)
+  assert_type(to, _number_nil, 2)
+  local first = from and self:bucket(from)
+  local next_bucket = self:buckets()
+  local bucket, bucket_node, next_entry
+  return function()
+    while true do
+      if next_entry then
+        local subnode, value, seq = next_entry()
+        if subnode then  return bucket_node(seq), value, bucket, tonumber(seq)  end
+      end
+      repeat  bucket = next_bucket()  until not bucket or not first or bucket >= first
+      if not bucket or (to and bucket >= to) then  return nil  end
+      bucket_node = self.node(bucket)
+      next_entry = bucket_node:__pairs()
+    end
+  end
+end
+
+--- Kill every bucket that ends at or before `before`, each with a single delete.
+-- @param[opt] before time in seconds since the epoch (default: `os.time()` less the `retain` option)
+-- @return number of buckets killed
+function timebuckets:expire(before)
+  assert_type(before, _number_nil, 1)
+  if not before then
+    assert(self.retain, "timebuckets:expire() requires a time unless option 'retain' was supplied")
+    before = os.time() - self.retain
+  end
+  local expired = {}
+  for bucket in self:buckets() do
+    if bucket + self.size > before then  break  end
+    table.insert(expired, self.node(bucket))
+  end
+  if #expired > 0 then  M.kill_many(expired)  end
+  return #expired
+end
+
+--- Kill all buckets.
+function timebuckets:kill()
+  self.node:kill()
+end
+
+--- @section end
+
+--- Streams
+-- @section
+
+-- Class metatable for an append-only stream of entries
+local stream = {}
+stream.__index = stream
+
+-- Append `n` entries of `batch` to stream node within a transaction; store the first offset in result[1].
+-- Uses a result table because the transaction function's return value is the transaction status.
+local stream_append = M.transaction(function(node, batch, n, result)
+  local first = tonumber(_yottadb.incr(node, n)) - n + 1
+  for i = 1, n do  _yottadb.set(node(first+i-1), batch[i])  end
+  result[1] = first
+end)
+
+--- Create an append-only stream of entries stored under a node, each identified by an increasing integer offset.
+-- Entries are stored at `node(offset)`, starting from offset 1, and the last offset assigned is stored at `node` itself.
+-- Readers fetch entries in chunks using a single call into C per chunk, and may follow new entries using `tail()`.
+-- @param node node object or variable name under which to store the stream
+-- @return stream object
+-- @example
+-- ydb = require('yottadb')
+-- events = ydb.stream('^Events')
+-- events:append({'created', 'updated'})
+-- -- 1
+-- events:read(1, 100)
+-- -- {'created', 'updated'}  {1, 2}
+-- for offset, value in events:tail(1, {consumer=ydb.node('^EventsReadBy', 'indexer')}) do
+--   print(offset, value)  -- follows new entries forever, resuming from the consumer's saved offset
+-- end
+function M.stream(node)
+  return setmetatable({node=M.isnode(node) and node or M.node(node)}, stream)
+end
+
+--- Append a batch of values to the stream, assigning them consecutive offsets using a single increment.
+-- The batch is appended in a transaction, so readers never see a partial batch or a gap in offsets.
+-- @param batch table array of values, or a single string or number
+-- @return offset of the first appended entry, or `nil` if the batch is empty
+function stream:append(batch)
+  if type(batch) ~= 'table' then  batch = {batch}  end
+  local n = #batch
+  if n == 0 then  return nil  end
+  local result = {}
+  stream_append(self.node, batch, n, result)
+  return result[1]
+end
+
+--- Return the offset of the last entry appended to the stream (0 if none).
+function stream:last()
+  return tonumber(_yottadb.get(self.node)) or 0
+end
+
+--- Read up to `max` entries starting from offset `from`, in a single call into C.
+-- @param[opt] from offset of the first entry to read (default 1)
+-- @param[opt] max maximum number of entries to read (default 100)
+-- @return table array of entry values
+-- @return table array of the offsets of those entries
+function stream:read(from, max)
+  assert_type(from, _number_nil, 1)
+  assert_type(max, _number_nil, 2)
+  if from and (from < 1 or from ~= math.floor(from)) then
+    error(string.format("bad argument #1 to 'read' (offset must be a positive integer, got %s)", from), 2)
+  end
+  if max and (max < 0 or max ~= math.floor(max)) then
+    error(string.format("bad argument #2 to 'read' (max must be a non-negative integer, got %s)", max), 2)
+  end
+  local offsets, values = _yottadb.scan(self.node, string.format('%d', (from or 1)-1), max or 100)
+  for i, offset in ipairs(offsets) do  offsets[i] = tonumber(offset)  end
+  return values, offsets
+end
+
+--- Return an iterator that follows the stream, polling for new entries when it reaches the end.
+-- If a `consumer` node is supplied, the offset to resume from is saved there after each chunk of entries
+-- has been processed, so that a restarted consumer resumes where it left off (entries since the last save are repeated).
+-- @param[opt] from offset of the first entry to return (default: saved `consumer` offset, or else the next entry appended)
+-- @param[opt] options table of options:
+--
+-- * `poll`: seconds to wait between polls when there are no new entries (default 0.1)
+-- * `chunk`: maximum number of entries to read at once (default 100)
+-- * `timeout`: seconds to wait for new entries before ending the iteration (default: wait forever)
+-- * `consumer`: node in which to save the offset of the next entry to process
+-- @return iterator that returns: offset, value
+function stream:tail(from, options)
+  assert_type(from, _number_nil, 1)
+  assert_type(options, _table_nil, 2)
+  options = options or {}
+  local poll, chunk, timeout, consumer = options.poll or 0.1, options.chunk or 100, options.timeout, options.consumer
+  local saved = consumer and tonumber(consumer:get())  -- offset last saved to `consumer`, to avoid saving it again
+  local offset = from or saved or self:last()+1
+  local values, offsets, i = {}, {}, 0
+  return function()
+    i = i + 1
+    local waited = 0
+    while i > #values do
+      if consumer and offset ~= saved then  -- all entries read so far have been processed
+        consumer:set(offset)
+        saved = offset
+      end
+      values, offsets = self:read(offset, chunk)
+      i = 1
+      if #values == 0 then
+        if timeout and waited >= timeout then  return nil  end
+        _yottadb.sleep(poll)
+        waited = waited + poll
+      end
+    end
+    offset = offsets[i] + 1
+    return offsets[i], values[i]
+  end
+end
+
+--- @section end
+
+--- Change capture
+-- @section
+
+-- Return the M name of a varname and subsarray, e.g. `^X("a","1")`, which `node_from_glvn()` can parse
+local function glvn(varname, subsarray)
+  if #subsarray == 0 then  return varname  end
+  return varname .. '(' .. table.concat(_yottadb.str2zwr_many(subsarray), ',') .. ')'
+end
+
+-- Return the M name of a node, e.g. `^X("a","1")`, which `node_from_glvn()` can parse
+local function node_glvn(node)
+  local subsarray = {}
+  for i = 1, _yottadb.cachearray_depth(node) do  subsarray[i] = _yottadb.cachearray_subscript(node, i)  end
+  return glvn(_yottadb.cachearray_subscript(node, 0), subsarray)
+end
+
+--- Create a node class whose changes are recorded in a change log, so that other systems can synchronise incrementally.
+-- Returns a function that creates nodes of the new class, as for `inherit()`. Every `set()` (including `node.__ = value`),
+-- `kill()` and `incr()` made through these nodes, or their subnodes, also appends a change record to the change log
+-- in the same transaction, so the log always matches the database. Each change record is an entry in a `stream()`
+-- whose offset is the change's sequence number and whose value is the operation and the node's M name, e.g. `set ^X("a")`.
+-- Read changes using `changes()`.
+--
+-- *Note:* only changes made through methods of these nodes are captured, not changes made by functions like `yottadb.set()`,
+-- by `node:settree()`, or by M code.
+-- @param changelog stream object, or node or variable name of a stream, in which to record changes
+-- @param[opt] node_func function that creates nodes of the class to inherit from (default `yottadb.node`)
+-- @return function that creates nodes of the new class
+-- @return subclass metatable
+-- @return superclass metatable
+-- @example
+-- ydb = require('yottadb')
+-- customer = ydb.capture_changes('^CustomerChanges')
+-- c = customer('^Customer', 'alice')
+-- c.email.__ = 'alice@example.com'
+-- c.visits:incr()
+-- for _, change in ipairs(ydb.changes('^CustomerChanges', 0)) do  print(change.seq, change.op, change.node)  end
+-- -- 1  set   ^Customer("alice","email")
+-- -- 2  incr  ^Customer("alice","visits")
+function M.capture_changes(changelog, node_func)
+  assert_type(node_func, _function_nil, 2)
+  if getmetatable(changelog) ~= stream then  changelog = M.stream(changelog)  end
+  local log = changelog.node
+  local newfunc, class, superclass = M.inherit(node_func or M.node)
+  -- Perform operation `op` on `self` and record it in the log, both in one transaction.
+  -- Store any result in result[1] because the transaction function's return value is the transaction status.
+  local capture = M.transaction(function(op, self, arg, result)
+    if op == 'set' then  superclass.set(self, arg)
+    elseif op == 'kill' then  superclass.kill(self)
+    else  result[1] = superclass.incr(self, arg)  end
+    _yottadb.set(log(_yottadb.incr(log)), op .. ' ' .. node_glvn(self))
+  end)
+  function class:set(value)  capture('set', self, value, {})  end
+  function class:kill()  capture('kill', self, nil, {})  end
+  function class:incr(increment)
+    assert_type(increment, _string_number_nil, 1, ":incr")
+    local result = {}
+    capture('incr', self, increment, result)
+    return result[1]
+  end
+  class.delete_tree = class.kill
+  return newfunc, class, superclass
+end
+
+--- Return changes recorded by nodes created by `capture_changes()` after sequence number `since`, in order.
+-- @param changelog stream object, or node or variable name of the stream in which changes were recorded
+-- @param[opt] since sequence number after which to return changes (default 0, i.e. all changes)
+-- @param[opt] max maximum number of changes to return (default 100)
+-- @return table array of changes, each a table with fields:
+--
+-- * `seq`: sequence number of the change. Pass the last one as `since` to fetch subsequent changes.
+-- * `op`: operation: `'set'`, `'kill'` or `'incr'`
+-- * `node`: node object that was changed (read its current value to synchronise it)
+function M.changes(changelog, since, max)
+  assert_type(since, _number_nil, 2)
+  if getmetatable(changelog) ~= stream then  changelog = M.stream(changelog)  end
+  local values, offsets = changelog:read((since or 0) + 1, max)
+  local changes = {}
+  for i, record in ipairs(values) do
+    local op, glvn = record:match('^(%a+) (.*)$')
+    changes[i] = {seq=offsets[i], op=op, node=M.node_from_glvn(glvn)}
+  end
+  return changes
+end
+
+--- @section end
+
+--- Maintained aggregates
+-- @section
+
+local aggregate_kinds = {count=true, sum=true, min=true, max=true}
+
+-- Return the number that M takes string `value` to be: its numeric prefix, e.g. `'12abc'` is 12 and `'abc'` is 0
+local function m_number(value)
+  value = tostring(value)
+  local number = value:match('^[+-]?%d*%.?%d*')
+  local exponent = value:match('^[Ee][+-]?%d+', #number+1)
+  return tonumber(number .. (exponent or '')) or 0
+end
+
+-- Call f(value) for the value of node and every node in its subtree
+local function each_value(node, f)
+  local value = _yottadb.get(node)
+  if value then  f(value)  end
+  for subscript in node:__subscripts() do  each_value(node(subscript), f)  end
+end
+
+--- Create a node class that keeps aggregates (count, sum, min, max) of the values under a watched node up to date as they change.
+-- Values under the watched node are grouped by the first subscript below it: that is, the values of node
+-- `watched(group, ...)` and its subtree are aggregated into group `group`.
+-- Aggregates of each group are stored at `target(group, kind)` for each `kind` of aggregate, so reading a total is a single `get`.
+-- Returns a function that creates nodes of the new class, as for `inherit()`. Every `set()` (including `node.__ = value`),
+-- `kill()` and `incr()` made through these nodes, or their subnodes, also updates the group's aggregates in the same transaction.
+-- Count and sum are updated with `incr()`. Min and max are updated directly unless the current min or max value
+-- is removed, in which case the group is rescanned.
+-- The count is always stored, even if not requested, because a group's aggregates are killed when its count drops to zero.
+-- Values are summed and compared as the numbers M takes them to be: their numeric prefix, e.g. `'12abc'` is 12 and `'abc'` is 0.
+--
+-- *Note:* only changes made through methods of these nodes update the aggregates.
+-- If the watched node already contains data, call `class.recompute_aggregates()` to initialise the aggregates.
+-- @param watched node or variable name whose subtree to aggregate
+-- @param target node or variable name under which to store the aggregates
+-- @param aggregates table array of the kinds of aggregate to maintain: any of `'count'`, `'sum'`, `'min'`, `'max'`
+-- @param[opt] node_func function that creates nodes of the class to inherit from (default `yottadb.node`)
+-- @return function that creates nodes of the new class
+-- @return subclass metatable, which also contains `recompute_aggregates([group])` to recompute one group or all groups
+-- @return superclass metatable
+-- @example
+-- ydb = require('yottadb')
+-- order = ydb.aggregated('^Orders', '^OrderTotals', {'count', 'sum', 'max'})
+-- order('^Orders', 'alice', 1).__ = 30
+-- order('^Orders', 'alice', 2).__ = 12
+-- ydb.get('^OrderTotals', 'alice', 'sum')
+-- -- 42
+-- order('^Orders', 'alice', 1):kill()
+-- ydb.get('^OrderTotals', 'alice', 'max')
+-- -- 12
+function M.aggregated(watched, target, aggregates, node_func)
+  assert_type(aggregates, 'table', 3)
+  assert_type(node_func, _function_nil, 4)
+  watched = M.isnode(watched) and watched or M.node(watched)
+  target = M.isnode(target) and target or M.node(target)
+  local kinds = {}
+  for _, kind in ipairs(aggregates) do
+    assert(aggregate_kinds[kind], string.format("aggregated() unknown kind of aggregate '%s'", kind))
+    kinds[kind] = true
+  end
+  local watched_depth = _yottadb.cachearray_depth(watched)
+  local watched_varname, watched_subsarray = watched:varname(), watched:subsarray()
+  local newfunc, class, superclass = M.inherit(node_func or M.node)
+
+  -- Return the aggregates node of the group that `node` belongs to
+  local function group_totals(node)
+    -- Compare cached subscripts directly, to avoid formatting the node's name on every write
+    local below = _yottadb.cachearray_depth(node) > watched_depth and _yottadb.cachearray_subscript(node, 0) == watched_varname
+    for i = 1, watched_depth do
+      if not below then  break  end
+      below = _yottadb.cachearray_subscript(node, i) == watched_subsarray[i]
+    end
+    assert(below, string.format("aggregated node %s must be below watched node %s", node, watched))
+    return target(_yottadb.cachearray_subscript(node, watched_depth+1))
+  end
+
+  -- Recompute min and max of the group at `totals` by scanning the group's values
+  local function rescan(totals)
+    local min, max
+    each_value(watched(_yottadb.cachearray_subscript(totals, -1)), function(value)
+      value = m_number(value)
+      if not min or value < min then  min = value  end
+      if not max or value > max then  max = value  end
+    end)
+    if kinds.min then  _yottadb.set(totals('min'), min)  end
+    if kinds.max then  _yottadb.set(totals('max'), max)  end
+  end
+
+  -- Update the group aggregates at `totals` for removal of the `removed` values and addition of value `added`
+  local function update(totals, removed, added)
+    local count, sum, needs_rescan = 0, 0, false
+    -- Stored min and max are always numbers, as converted by m_number(), so tonumber() only returns nil if they are absent
+    local min = kinds.min and tonumber(_yottadb.get(totals('min')))
+    local max = kinds.max and tonumber(_yottadb.get(totals('max')))
+    for _, value in ipairs(removed) do
+      value = m_number(value)
+      count, sum = count-1, sum-value
+      if value == min or value == max then  needs_rescan = true  end
+    end
+    if added ~= nil then
+      local value = m_number(added)
+      count, sum = count+1, sum+value
+      if kinds.min and not needs_rescan and (not min or value < min) then  _yottadb.set(totals('min'), value)  end
+      if kinds.max and not needs_rescan and (not max or value > max) then  _yottadb.set(totals('max'), value)  end
+    end
+    if kinds.sum and sum ~= 0 then  _yottadb.incr(totals('sum'), sum)  end
+    if count ~= 0 and tonumber(_yottadb.incr(totals('count'), count)) == 0 then
+      _yottadb.delete(totals, _yottadb.YDB_DEL_TREE)
+      return
+    end
+    if needs_rescan then  rescan(totals)  end
+  end
+
+  -- Perform operation `op` on `self` and update its aggregates, both in one transaction.
+  -- Store any result in result[1] because the transaction function's return value is the transaction status.
+  local maintain = M.transaction(function(op, self, arg, result)
+    local totals = group_totals(self)
+    local removed = {}
+    if op == 'kill' then
+      each_value(self, function(value)  table.insert(removed, value)  end)
+      superclass.kill(self)
+      update(totals, removed, nil)
+      return
+    end
+    local old = _yottadb.get(self)
+    if old ~= nil then  removed[1] = old  end
+    if op == 'set' then
+      superclass.set(self, arg)
+      update(totals, removed, arg)
+    else
+      result[1] = superclass.incr(self, arg)
+      update(totals, removed, result[1])
+    end
+  end)
+  function class:set(value)  maintain('set', self, value, {})  end
+  function class:kill()  maintain('kill', self, nil, {})  end
+  function class:incr(increment)
+    assert_type(increment, _string_number_nil, 1, ":incr")
+    local result = {}
+    maintain('incr', self, increment, result)
+    return result[1]
+  end
+  class.delete_tree = class.kill
+
+  -- Recompute the aggregates of `group`, or of all groups if `group` is nil, from the values under the watched node
+  class.recompute_aggregates = M.transaction(function(group)
+    if group == nil then
+      target:kill()
+      for subscript in watched:__subscripts() do  class.recompute_aggregates(subscript)  end
+      return
+    end
+    local totals = target(group)
+    _yottadb.delete(totals, _yottadb.YDB_DEL_TREE)
+    local count, sum = 0, 0
+    each_value(watched(group), function(value)  count, sum = count+1, sum+(m_number(value))  end)
+    if count == 0 then  return  end
+    _yottadb.set(totals('count'), count)
+    if kinds.sum then  _yottadb.set(totals('sum'), sum)  end
+    rescan(totals)
+  end)
+  return newfunc, class, superclass
+end
+
+--- @section end
+
+--- Compressed nodes
+-- @section
+
+--- Create a node class that transparently compresses large values.
+-- Values of at least `threshold` bytes are compressed in C with a fast LZ77 codec before they are stored, if that makes them smaller.
+-- Compressed values are marked by a header byte (0xFE), so compressed and uncompressed values may be mixed in the same
+-- global, and `get()` decompresses them in C as part of the same call.
+-- Values are decompressed by this class's `get()`, `node.__` and `pairs()`, but other functions like `yottadb.get()`
+-- and `gettree()` return the stored (possibly compressed) value, which can be decoded with `yottadb.decompress()`.
+-- @param[opt] threshold minimum length in bytes of values to compress (default 256)
+-- @param[opt] node_func function that creates nodes of the class to inherit from (default `yottadb.node`)
+-- @return function that creates nodes of the new class
+-- @return subclass metatable
+-- @return superclass metatable
+-- @example
+-- ydb = require('yottadb')
+-- doc = ydb.compressed()
+-- n = doc('^docs', 1)
+-- n.__ = string.rep('{"name": "value"}, ', 100)
+-- #ydb.get('^docs', 1)
+-- -- 35
+-- #n.__
+-- -- 1900
+function M.compressed(threshold, node_func)
+  assert_type(threshold, _number_nil, 1)
+  assert_type(node_func, _function_nil, 2)
+  threshold = threshold or 256
+  local newfunc, class, superclass = M.inherit(node_func or M.node)
+  function class:get(default)  return _yottadb.get_decompressed(self) or default  end
+  function class:set(value)  _yottadb.set(self, value ~= nil and _yottadb.compress(value, threshold) or nil)  end
+  function class:__pairs(reverse, typed)
+    local iterator, state, initial = superclass.__pairs(self, reverse, typed)
+    return function(...)
+      local subnode, value, subscript = iterator(...)
+      return subnode, _yottadb.decompress(value), subscript
+    end, state, initial
+  end
+  class.pairs = class.__pairs
+  return newfunc, class, superclass
+end
+
+--- Encode a value as stored by nodes created by `compressed()`.
+-- @function compress
+-- @param value string to encode
+-- @param[opt] threshold minimum length in bytes of value to compress (default 0)
+-- @return encoded string
+M.compress = _yottadb.compress
+
+--- Decode a value stored by nodes created by `compressed()`, e.g. a value fetched by `yottadb.get()`.
+-- Values that were never compressed are returned unchanged.
+-- @function decompress
+-- @param value string to decode, or `nil`
+-- @return decoded string, or `nil` if value is `nil`
+M.decompress = _yottadb.decompress
+
+--- @section end
+
+--- Deduplicated nodes
+-- @section
+
+local dedup_reference = '\254H'  -- prefix of a stored reference to a blob: must match COMPRESSED_MARKER and DEDUP_REFERENCE in C
+
+--- Create a node class that stores each distinct large value only once.
+-- Values of at least `threshold` bytes are stored once in `blobs(hash)`, keyed by their SHA-256 hash,
+-- and the node itself stores only a reference to the hash.
+-- `blobs(hash, 'refs')` counts the references to each blob, and is maintained in the same transaction as each `set()` or `kill()`
+-- made through these nodes, so that a blob is deleted along with its last reference.
+-- `get()`, `node.__` and `pairs()` resolve references in C through a small cache of recently used blobs.
+-- Since blobs are keyed by their content, cached blobs can never be stale.
+--
+-- *Note:* other functions like `yottadb.get()` and `gettree()` return the stored reference rather than the value,
+-- and changes made other than through these nodes do not maintain the reference counts.
+-- @param blobs node or variable name under which to store blobs
+-- @param[opt] threshold minimum length in bytes of values to deduplicate (default 1024)
+-- @param[opt] node_func function that creates nodes of the class to inherit from (default `yottadb.node`)
+-- @return function that creates nodes of the new class
+-- @return subclass metatable
+-- @return superclass metatable
+-- @example
+-- ydb = require('yottadb')
+-- record = ydb.dedup('^blobs')
+-- template = string.rep('boilerplate ', 1000)
+-- record('^records', 1, 'body').__ = template
+-- record('^records', 2, 'body').__ = template
+-- ydb.get('^blobs', ydb.sha256(template), 'refs')
+-- -- 2
+function M.dedup(blobs, threshold, node_func)
+  assert_type(threshold, _number_nil, 2)
+  assert_type(node_func, _function_nil, 3)
+  blobs = M.isnode(blobs) and blobs or M.node(blobs)
+  threshold = threshold or 1024
+  local newfunc, class, superclass = M.inherit(node_func or M.node)
+
+  -- Return `value` encoded for storage, storing it as a blob (or adding a reference to an existing blob) if it is large
+  local function store(value)
+    value = tostring(value)
+    if #value < threshold then
+      return value:byte(1) == 0xFE and '\254R' .. value or value  -- escape values that look like a reference
+    end
+    local hash = _yottadb.sha256(value)
+    if tonumber(_yottadb.incr(blobs(hash, 'refs'))) == 1 then  _yottadb.set(blobs(hash), value)  end
+    return dedup_reference .. hash
+  end
+  -- Drop the reference held by `stored`, if it is one, deleting its blob if that was the last reference
+  local function release(stored)
+    if #stored == 2+64 and stored:sub(1, 2) == dedup_reference then
+      local hash = stored:sub(3)
+      if tonumber(_yottadb.incr(blobs(hash, 'refs'), -1)) <= 0 then  _yottadb.delete(blobs(hash), _yottadb.YDB_DEL_TREE)  end
+    end
+  end
+  local update = M.transaction(function(self, value, kill)
+    if kill then
+      each_value(self, release)
+      superclass.kill(self)
+      return
+    end
+    local old = _yottadb.get(self)
+    _yottadb.set(self, value ~= nil and store(value) or nil)
+    if old then  release(old)  end
+  end)
+
+  function class:get(default)  return _yottadb.dedup_get(self, blobs) or default  end
+  function class:set(value)  update(self, value)  end
+  function class:kill()  update(self, nil, true)  end
+  class.delete_tree = class.kill
+  function class:__pairs(reverse, typed)
+    local iterator, state, initial = superclass.__pairs(self, reverse, typed)
+    return function(...)
+      local subnode, value, subscript = iterator(...)
+      if value and value:byte(1) == 0xFE then  value = _yottadb.dedup_get(subnode, blobs)  end
+      return subnode, value, subscript
+    end, state, initial
+  end
+  class.pairs = class.__pairs
+  return newfunc, class, superclass
+end
+
+--- Return the SHA-256 hash of a string as 64 lowercase hex digits, as used to key blobs stored by `dedup()`.
+-- @function sha256
+-- @param s string
+-- @return hash string
+M.sha256 = _yottadb.sha256
+
+--- @section end
+
+--- Graphs
+-- @section
+
+-- Class metatable for a graph stored as adjacency subscripts
+local graph = {}
+graph.__index = graph
+
+--- Create a graph object for a graph stored as adjacency subscripts under a node.
+-- An edge from vertex `v` to vertex `w` is the node `node(v, w)`, whose value (if any) is ignored by traversals.
+-- Traversals run in C, keeping the frontier and the set of visited vertices there, and return only the resulting vertices to Lua.
+-- @param node node object or variable name under which the graph is stored
+-- @return graph object
+-- @example
+-- ydb = require('yottadb')
+-- ydb.set('^G', 'alice', 'bob', '')
+-- ydb.set('^G', 'bob', 'carol', '')
+-- g = ydb.graph('^G')
+-- g:bfs('alice')
+-- -- {'alice', 'bob', 'carol'}  {0, 1, 2}
+-- g:neighbors('alice')
+-- -- {'bob'}
+function M.graph(node)
+  return setmetatable({node=M.isnode(node) and node or M.node(node)}, graph)
+end
+
+--- Return the vertices reachable from `start` in breadth-first order.
+-- @param start vertex to start from (string or number)
+-- @param[opt] options table of options:
+--
+-- * `max_depth`: maximum number of edges to follow from `start` (default unlimited)
+-- * `limit`: maximum number of vertices to return, including `start` (default unlimited)
+-- @return table array of vertex strings in the order visited, starting with `start`
+-- @return table array of the depth of each of those vertices (`start` has depth 0)
+function graph:bfs(start, options)
+  assert_type(start, _string_number, 1, ":bfs")
+  assert_type(options, _table_nil, 2, ":bfs")
+  options = options or {}
+  assert_type(options.max_depth, _number_nil, 2, ":bfs")
+  assert_type(options.limit, _number_nil, 2, ":bfs")
+  return _yottadb.bfs(self.node, tostring(start), options.max_depth, options.limit)
+end
+
+--- Return the vertices that vertex `v` has edges to, in collation order, including `v` itself if it has a self-loop.
+-- @param v vertex (string or number)
+-- @return table array of vertex strings, which is empty if `v` has no edges
+function graph:neighbors(v)
+  assert_type(v, _string_number, 1, ":neighbors")
+  local vertices = {}
+  for w in self.node(v):subscripts() do  table.insert(vertices, w)  end
+  return vertices
+end
+
+--- @section end
+
+--- Resumable scans
+-- @section
+
+--- Iterate every node with a value in the tree under `node`, in collation order, saving progress so an interrupted scan can resume.
+-- The iterator regularly saves a checkpoint of the full subscript path of the last node the loop finished processing,
+-- at node `checkpoint`. If a checkpoint exists when the scan starts, the scan resumes after that node instead of from
+-- the beginning. When the scan completes, the checkpoint is killed so that the next scan starts from the beginning.
+--
+-- A node is regarded as processed when the loop asks for the next node. So after an interruption, the nodes processed
+-- since the last checkpoint are scanned again: make sure that processing a node twice is harmless.
+-- @param node node object or variable name whose tree to scan
+-- @param checkpoint node object or variable name at which to store the checkpoint: its value is the M name of the last node
+-- processed, and `checkpoint('count')` holds the number of nodes processed by this and any previous interrupted runs
+-- @param[opt] options table of options:
+--
+-- * `every`: save a checkpoint after processing this many nodes (default 1000)
+-- * `seconds`: also save a checkpoint if this many seconds have passed since the last one (default never)
+-- @return iterator that yields, for each node, a table of its subscripts (the full path after its varname) and its value
+-- @example
+-- ydb = require('yottadb')
+-- for subs, value in ydb.resumable_scan('^Huge', ydb.node('^ScanState', 'reindex'), {every=10000, seconds=60}) do
+--   reindex(subs, value)
+-- end
+function M.resumable_scan(node, checkpoint, options)
+  assert_type(options, _table_nil, 3)
+  options = options or {}
+  assert_type(options.every, _number_nil, 3)
+  assert_type(options.seconds, _number_nil, 3)
+  node = M.isnode(node) and node or M.node(node)
+  checkpoint = M.isnode(checkpoint) and checkpoint or M.node(checkpoint)
+  local every, seconds = options.every or 1000, options.seconds
+  local varname, prefix = node:varname(), node:subsarray()
+  local depth = #prefix
+  local subs, count = prefix, 0
+  local saved = _yottadb.get(checkpoint)
+  if saved then
+    subs = M.node_from_glvn(saved):subsarray()
+    count = tonumber(_yottadb.get(checkpoint('count'))) or 0
+  end
+  local processed, unsaved, saved_time = nil, 0, os.time()
+  local include_self = not saved and node:has_value()
+
+  -- Save the count and position together in a transaction so that a crash cannot leave them inconsistent
+  local save_checkpoint = M.transaction(function()
+    _yottadb.set(checkpoint('count'), count)
+    _yottadb.set(checkpoint, glvn(varname, processed))
+  end)
+  local function save()
+    save_checkpoint()
+    unsaved, saved_time = 0, os.time()
+  end
+
+  return function()
+    if processed then
+      count, unsaved = count+1, unsaved+1
+      if unsaved >= every or (seconds and os.time()-saved_time >= seconds) then  save()  end
+    end
+    local next_subs
+    if include_self then
+      next_subs, include_self = prefix, false
+    else
+      next_subs = _yottadb.node_next(varname, subs)
+      for i = 1, depth do
+        if not next_subs or next_subs[i] ~= prefix[i] then  next_subs = nil  break  end
+      end
+    end
+    if not next_subs then
+      _yottadb.delete(checkpoint, _yottadb.YDB_DEL_TREE)
+      return nil
+    end
+    subs, processed = next_subs, next_subs
+    return subs, _yottadb.get(varname, subs)
+  end
+end
+
+--- @section end
+
+--- External sorting
+-- @section
+
+--- Sort or group a dataset too large for memory by spilling it into a scratch node in the database.
+-- Every value produced by `iter` is stored as `scratch(key, n)`, where `key` is its sort key and `n` is a sequence number,
+-- so that M collation does the sorting. The values are then streamed back in key order without loading them all into memory.
+-- Values with equal keys are returned in the order `iter` produced them, i.e. the sort is stable.
+--
+-- Keys are ordered by M collation: number keys are stored in M canonical form (e.g. `0.5` as `'.5'`), so they sort
+-- numerically before all string keys, as do string keys that are already canonical numbers (e.g. `'12'`).
+-- Such keys are returned as Lua numbers. Values are returned as strings because they come from the database.
+-- The scratch node is killed before the sort starts and when the returned iterator completes.
+-- If the loop exits early, call `scratch:kill()` to free the space.
+-- @param iter iterator function that returns the next string or number to sort on each call, and `nil` when done
+-- @param[opt] options table of options:
+--
+-- * `key`: function that returns the sort key of a value (default: the value itself)
+-- * `scratch`: node object or variable name to spill values into (default: a new `temp()` node)
+-- * `group`: set to true to iterate each distinct key along with an iterator over its values
+-- @return iterator that yields `value, key` in sorted order, or if `group` is set, yields `key, values_iterator`
+-- where `values_iterator` is valid only until the next key is fetched
+-- @example
+-- ydb = require('yottadb')
+-- for line, amount in ydb.sort(io.lines('orders.csv'), {key=function(line)  return tonumber(line:match(',(%d+)$'))  end}) do
+--   print(amount, line)
+-- end
+-- @example
+-- for customer, orders in ydb.sort(io.lines('orders.csv'), {key=function(line)  return line:match('^[^,]*')  end, group=true}) do
+--   local count = 0
+--   for order in orders do  count = count + 1  end
+--   print(customer, count)
+-- end
+function M.sort(iter, options)
+  assert_type(iter, 'function', 1)
+  assert_type(options, _table_nil, 2)
+  options = options or {}
+  assert_type(options.key, _function_nil, 2)
+  local keyfn, scratch = options.key, options.scratch
+  scratch = not scratch and M.temp() or M.isnode(scratch) and scratch or M.node(scratch)
+  scratch:kill()
+
+  -- Spill values into scratch(key, n), reusing one subscript table to avoid creating a node for each value
+  local varname, subs = scratch:varname(), scratch:subsarray()
+  local depth = #subs
+  local n = 0
+  for value in iter do
+    assert_type(value, _string_number, 1)
+    local key = value
+    if keyfn then  key = assert_type(keyfn(value), _string_number, 'key')  end
+    if type(key) == 'number' then  key = canonical_number(key)  end
+    n = n + 1
+    subs[depth+1], subs[depth+2] = key, n
+    _yottadb.set(varname, subs, value)
+  end
+
+  -- Return the next key both as typed by node_next() and as its subscript string; kill the scratch node when done
+  local keynode = _yottadb.cachearray_tomutable(_yottadb.cachearray_append(scratch, ''))
+  local function next_key()
+    local key, str = _yottadb.subscript_next(keynode, true)
+    keynode = _yottadb.cachearray_subst(keynode, str or '')
+    if not key then  scratch:kill()  end
+    return key, str
+  end
+
+  -- Return an iterator over the values stored under key subscript `str`, fetched in chunks
+  local function values(str)
+    local node = _yottadb.cachearray_append(scratch, str)
+    local chunk, cursor, i = {}, '', 0
+    return function()
+      i = i + 1
+      while not chunk[i] and cursor do
+        chunk, cursor = select(2, _yottadb.scan(node, cursor, 1000))
+        i = 1
+      end
+      return chunk[i]
+    end
+  end
+
+  if options.group then
+    return function()
+      local key, str = next_key()
+      if key ~= nil then  return key, values(str)  end
+    end
+  end
+  local key, key_values
+  return function()
+    while true do
+      local value = key_values and key_values()
+      if value then  return value, key  end
+      local str
+      key, str = next_key()
+      if key == nil then  return nil  end
+      key_values = values(str)
+    end
+  end
+end
+
+--- @section end
+
+--- Process-scoped scratch nodes
+-- @section
+
+local temp_counts = {}  -- for each temp varname used by this process, the number of temp nodes allocated
+local temp_sentinels = {}  -- objects whose finalizers kill this process's temp nodes when Lua closes
+
+-- Call function `f` when the Lua state closes, which happens when a program exits normally
+local function on_close(f)
+  local sentinel
+  if newproxy then  -- Lua 5.1 only calls __gc for userdata
+    sentinel = newproxy(true)
+    getmetatable(sentinel).__gc = f
+  else
+    sentinel = setmetatable({}, {__gc=f})
+  end
+  table.insert(temp_sentinels, sentinel)
+end
+
+--- Kill the temp nodes left behind by processes that have died without cleaning up, e.g. because they crashed.
+-- The temp nodes under `varname(pid)` are killed if no process with that pid is running, as determined by
+-- `_yottadb.process_alive()` (the equivalent of `$ZGETJPI(pid,"ISPROCALIVE")`).
+-- Liveness is deliberately not tracked with a YDB lock, since `yottadb.lock()` releases every lock a process holds.
+-- If a dead process's pid has been reused by another process, its nodes are only reclaimed once that process also ends.
+-- This is called automatically the first time a process calls `temp()` with a given `varname`.
+-- Only use it with globals that are accessed only from this machine, since processes on other machines cannot be checked.
+-- @param[opt] varname name of the global under which temp nodes are allocated (default `'^%ydbtmp'`)
+-- @return number of dead processes whose temp nodes were killed
+function M.temp_reclaim(varname)
+  assert_type(varname, _string_nil, 1)
+  varname = varname or '^%ydbtmp'
+  local job, reclaimed = M.get('$JOB'), 0
+  for pid in M.node(varname):subscripts() do
+    local number = tonumber(pid)
+    if pid ~= job and number and number >= 1 and number == math.floor(number) and not _yottadb.process_alive(number) then
+      M.node(varname, pid):kill()
+      reclaimed = reclaimed + 1
+    end
+  end
+  return reclaimed
+end
+
+--- Allocate a new, empty scratch node for use by this process only, e.g. for intermediate results.
+-- Temp nodes are allocated as `varname($JOB, n)`. They are killed automatically when the process exits normally, and
+-- reclaimed by the next process to use `temp()` if this process dies without cleaning up (see `temp_reclaim()`).
+-- To avoid the overhead of journaling scratch data, map the temp global to a region that is not journaled
+-- and which need not survive a crash, e.g. by using GDE to: `add -name %ydbtmp -region=YDBTMP`.
+-- @param[opt] varname name of the global under which to allocate temp nodes (default `'^%ydbtmp'`)
+-- @return node object of the new temp node
+-- @example
+-- ydb = require('yottadb')
+-- totals = ydb.temp()
+-- for _, order in ipairs(orders) do  totals(order.customer):incr(order.amount)  end
+-- totals:dump()
+-- totals:kill()  -- optional: it will be killed at exit anyway
+function M.temp(varname)
+  assert_type(varname, _string_nil, 1)
+  varname = varname or '^%ydbtmp'
+  if not temp_counts[varname] then
+    -- Any nodes already under our own $JOB were left behind by a dead process that had the same pid
+    local owner = M.node(varname, M.get('$JOB'))
+    owner:kill()
+    M.temp_reclaim(varname)
+    on_close(function()  pcall(owner.kill, owner)  end)
+    temp_counts[varname] = 0
+  end
+  temp_counts[varname] = temp_counts[varname] + 1
+  return M.node(varname, M.get('$JOB'), temp_counts[varname])
+end
+
+--- @section end
+
+--- Shadow rebuilds
+-- @section
+
+-- Class metatable for readers of a node that is rebuilt by `rebuild()`
+local rebuilt = {}
+rebuilt.__index = rebuilt
+
+--- Rebuild a derived node, such as an index, into a shadow version and then atomically switch readers over to it.
+-- Each version is built under `target('v', generation)` and `target('current')` holds the generation that readers use.
+-- So readers never see a half-built version, and the builder does not contend for locks with readers of the current version.
+-- Readers access the current version using `rebuilt()`.
+--
+-- The previous version is kept until the start of the next rebuild, so that readers still working through it are
+-- not disturbed. If `builder` raises an error, its partly-built version is killed and readers keep the current version.
+-- Concurrent rebuilds of the same target are serialised by a lock on `target('rebuild')`.
+-- @param target node object or variable name of the node to rebuild
+-- @param builder function `builder(shadow)` that populates the empty node object `shadow` with the new version
+-- @return generation number of the new version
+-- @example
+-- ydb = require('yottadb')
+-- ydb.rebuild('^ByEmail', function(shadow)
+--   for id, email in ydb.node('^Users'):scan() do  shadow(email):set(id)  end
+-- end)
+-- byemail = ydb.rebuilt('^ByEmail')
+-- byemail('bob@example.com'):get()
+function M.rebuild(target, builder)
+  assert_type(builder, 'function', 2)
+  target = M.isnode(target) and target or M.node(target)
+  local lock = target('rebuild')
+  lock:lock_incr()
+  local ok, result = pcall(function()
+    -- Drop every version but the current one: i.e. the previous version and any left by a crashed rebuild
+    local current = target('current'):get()
+    for generation in target('v'):subscripts() do
+      if generation ~= current then  target('v', generation):kill()  end
+    end
+    local generation = target('next'):incr()
+    local shadow = target('v', generation)
+    local ok, err = pcall(builder, shadow)
+    if not ok then
+      shadow:kill()
+      error(err, 0)
+    end
+    target('current'):set(generation)
+    return tonumber(generation)
+  end)
+  lock:lock_decr()
+  if not ok then  error(result, 0)  end
+  return result
+end
+
+--- Create a reader of a node rebuilt by `rebuild()`, which resolves to the current version of that node.
+-- Each access checks the current generation with a single `get()`, and only creates a new node object for the
+-- version when the generation has changed since the last access.
+-- Calling the reader, e.g. `reader(sub1, sub2)`, is the same as `reader:node()(sub1, sub2)`.
+-- @param target node object or variable name of the node that is rebuilt
+-- @return reader object
+function M.rebuilt(target)
+  target = M.isnode(target) and target or M.node(target)
+  return setmetatable({target=target, current=target('current')}, rebuilt)
+end
+
+--- Return the node object of the current version, or `nil` if the target has never been built.
+function rebuilt:node()
+  local generation = _yottadb.get(self.current)
+  if generation ~= self.generation then
+    self.generation, self.version = generation, generation and self.target('v', generation)
+  end
+  return self.version
+end
+
+--- Return the generation number of the current version, or `nil` if the target has never been built.
+function rebuilt:generation_number()
+  self:node()
+  return tonumber(self.generation)
+end
+
+function rebuilt:__call(...)
+  local version = self:node()
+  if not version then  error(string.format("%s has not been built by rebuild()", self.target), 2)  end
+  return version(...)
+end
+
+--- @section end
+
+--- Benchmark datasets
+-- @section
+
+--- Populate a node with a large synthetic tree for benchmarks, quickly and reproducibly.
+-- The tree is generated in C with a seeded pseudo-random number generator, so the same options always produce the same
+-- tree. It has `count` leaf nodes at `depth` levels of subscripts below `node`. Each level below the first has up to
+-- `fanout` children per parent, and the first level has as many children as it takes to hold `count` leaves.
+-- Only leaf nodes have values, which are strings of pseudo-random lowercase letters.
+-- @param node node object or variable name to populate
+-- @param[opt] options table of options:
+--
+-- * `count`: number of leaf nodes to set (default 1000)
+-- * `depth`: number of subscript levels below `node` (default 1)
+-- * `fanout`: maximum number of children per parent below the first level (default 10)
+-- * `value_size_dist`: size of values in bytes (default 10), either a number for a fixed size, or a table
+--   `{min=, max=}` for sizes uniformly distributed in that range, or `{mean=, min=0, max=}` for sizes exponentially
+--   distributed with that mean (a realistic long tail of large values) but clamped to that range
+-- * `key_kind`: `'int'` for integer subscripts that collate in creation order (default), or `'str'` for subscripts of
+--   7 letters that are unique among siblings but collate in scrambled order
+-- * `seed`: integer seed for the pseudo-random values and keys (default 1)
+-- @return number of nodes set
+-- @example
+-- ydb = require('yottadb')
+-- ydb.bench_generate('^bench', {count=1e6, depth=3, fanout=100, value_size_dist={mean=200, max=4000}, key_kind='str'})
+function M.bench_generate(node, options)
+  assert_type(options, _table_nil, 2)
+  options = options or {}
+  assert_type(options.count, _number_nil, 2)
+  assert_type(options.depth, _number_nil, 2)
+  assert_type(options.fanout, _number_nil, 2)
+  assert_type(options.value_size_dist, _table_number_nil, 2)
+  assert_type(options.key_kind, _string_nil, 2)
+  assert_type(options.seed, _number_nil, 2)
+  node = M.isnode(node) and node or M.node(node)
+  local key_kind = options.key_kind or 'int'
+  if key_kind ~= 'int' and key_kind ~= 'str' then
+    error(string.format("key_kind must be 'int' or 'str', not '%s'", key_kind), 2)
+  end
+  local dist = options.value_size_dist or 10
+  local min_size, max_size, mean_size
+  if type(dist) == 'number' then
+    min_size, max_size = dist, dist
+  else
+    mean_size = dist.mean
+    min_size, max_size = dist.min or (mean_size and 0 or dist.max), dist.max
+    if not max_size then  error("value_size_dist table must specify max", 2)  end
+  end
+  return _yottadb.generate(node, options.count or 1000, options.depth or 1, options.fanout or 10,
+    key_kind == 'str', options.seed or 1, min_size, max_size, mean_size)
+end
+
+--- @section end
+
 -- ~~~ Deprecated object that represents a YDB node ~~~
 
 --- Key class
@@ -1538,7 +2995,10 @@ key_properties = {
   __subsarray = key.subsarray,  -- retained for backward compatibility
 }
 
-local key_values = {}  -- Simulate node attribute storage using another table of tables since userdata can't store values
+-- Simulate node attribute storage using another table of tables since userdata can't store values.
+-- Weak keys let key objects be garbage collected along with their attributes
+-- (in Lua 5.1, which lacks ephemerons, only if the attributes do not themselves reference the key object).
+local key_values = setmetatable({}, {__mode='k'})
 
 -- Returns indexes into the key
 -- Search order for key attribute k:
@@ -1685,5 +3145,9 @@ end
 M._node = node
 M._key = key
 M._key_properties = key_properties
+M._key_values = key_values
+M._partitioned = partitioned
+M._timebuckets = timebuckets
+M._stream = stream
 
 return M